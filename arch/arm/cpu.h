@@ -65,6 +65,10 @@ typedef struct DisasContext {
     int vfp_enabled;
     int vec_len;
     int vec_stride;
+#ifdef TARGET_PROTO_ARM_M
+    int handler_mode;
+    int exception_return;
+#endif
 } DisasContext;
 
 /* ARM-specific interrupt pending bits.  */
@@ -471,7 +475,9 @@ static inline int cpu_mmu_index (CPUState *env)
 #define ARM_TBFLAG_VFPEN_MASK      (1 << ARM_TBFLAG_VFPEN_SHIFT)
 #define ARM_TBFLAG_CONDEXEC_SHIFT  8
 #define ARM_TBFLAG_CONDEXEC_MASK   (0xff << ARM_TBFLAG_CONDEXEC_SHIFT)
-/* Bits 31..16 are currently unused. */
+#define ARM_TBFLAG_HANDLER_SHIFT   16
+#define ARM_TBFLAG_HANDLER_MASK    (1 << ARM_TBFLAG_HANDLER_SHIFT)
+/* Bits 31..17 are currently unused. */
 
 /* some convenience accessor macros */
 #define ARM_TBFLAG_THUMB(F) \
@@ -486,6 +492,8 @@ static inline int cpu_mmu_index (CPUState *env)
     (((F) & ARM_TBFLAG_VFPEN_MASK) >> ARM_TBFLAG_VFPEN_SHIFT)
 #define ARM_TBFLAG_CONDEXEC(F) \
     (((F) & ARM_TBFLAG_CONDEXEC_MASK) >> ARM_TBFLAG_CONDEXEC_SHIFT)
+#define ARM_TBFLAG_HANDLER(F) \
+    (((F) & ARM_TBFLAG_HANDLER_MASK) >> ARM_TBFLAG_HANDLER_SHIFT)
 
 static inline void cpu_get_tb_cpu_state(CPUState *env, target_ulong *pc, target_ulong *cs_base, int *flags)
 {
@@ -496,6 +504,9 @@ static inline void cpu_get_tb_cpu_state(CPUState *env, target_ulong *pc, target_
              (env->vfp.vec_stride << ARM_TBFLAG_VECSTRIDE_SHIFT) | (env->condexec_bits << ARM_TBFLAG_CONDEXEC_SHIFT);
 #ifdef TARGET_PROTO_ARM_M
     privmode = !((env->v7m.exception == 0) && (env->v7m.control & 1));
+    if (env->v7m.exception != 0) {
+        *flags |= ARM_TBFLAG_HANDLER_MASK;
+    }
 #else
     privmode = (env->uncached_cpsr & CPSR_M) != ARM_CPU_MODE_USR;
 #endif
@@ -520,6 +531,11 @@ static inline bool cpu_has_work(CPUState *env)
 #endif
 }
 
+/* called when the halted CPU has no work */
+static inline void cpu_idle(CPUState *env)
+{
+}
+
 #include "exec-all.h"
 
 static inline void cpu_pc_from_tb(CPUState *env, TranslationBlock *tb)
@@ -634,6 +634,14 @@ void do_v7m_exception_exit(CPUState *env)
        pointer.  */
 }
 
+/* Loading EXC_RETURN into the PC in handler mode returns from the exception.  */
+void HELPER(v7m_exception_return)(CPUState * env)
+{
+    if (env->regs[15] >= 0xffffffe0) {
+        do_v7m_exception_exit(env);
+    }
+}
+
 void HELPER(fp_lsp)(CPUState * env)
 {
     /* Save FP state if FPCCR.LSPACT is set  */
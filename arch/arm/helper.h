@@ -63,6 +63,7 @@ DEF_HELPER_3(v7m_msr, void, env, i32, i32)
 DEF_HELPER_2(v7m_mrs, i32, env, i32)
 
 DEF_HELPER_1(fp_lsp, void, env)
+DEF_HELPER_1(v7m_exception_return, void, env)
 #endif
 
 DEF_HELPER_3(set_cp15, void, env, i32, i32)
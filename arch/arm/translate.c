@@ -703,6 +703,14 @@ static inline void gen_bx(DisasContext *s, TCGv var)
     tcg_gen_andi_i32(cpu_R[15], var, ~1);
     tcg_gen_andi_i32(var, var, 1);
     store_cpu_field(var, thumb);
+#ifdef TARGET_PROTO_ARM_M
+    /* bx, pop {pc}, ldm and ldr into pc are the only instructions
+       that can perform an exception return; it is checked once the
+       whole instruction, including the base register writeback, is done */
+    if (s->handler_mode) {
+        s->exception_return = 1;
+    }
+#endif
 }
 
 /* Variant of store_reg which uses branch&exchange logic when storing
@@ -728,6 +736,10 @@ static inline void store_reg_from_load(CPUState *env, DisasContext *s, int reg,
     } else {
         store_reg(s, reg, var);
     }
+    if (reg == 15) {
+        /* pop {pc} and ldr pc are the usual function returns */
+        gen_call_trace_return(cpu_R[15]);
+    }
 }
 
 static inline TCGv gen_ld8s(TCGv addr, int index)
@@ -2530,53 +2542,107 @@ static int cp15_user_ok(CPUState *env, uint32_t insn)
     return 0;
 }
 
-static int cp15_tls_load_store(CPUState *env, DisasContext *s, uint32_t insn, uint32_t rd)
+/* cp15 registers that are plain storage in CPUState.  Accesses to them are
+   resolved at translation time and generated as loads and stores of the
+   field, everything else (registers with side effects on writes, like the
+   SCTLR or CONTEXTIDR, and the implementation defined ones) goes through the
+   get_cp15/set_cp15 helpers.  */
+#define CP15_R  (1 << 0) /* mrc is a load of the field */
+#define CP15_W  (1 << 1) /* mcr is a store to the field */
+#define CP15_RW (CP15_R | CP15_W)
+
+#define CP15_FEATURE(f) (1u << ARM_FEATURE_ ## f)
+
+typedef struct CP15RegInfo {
+    uint8_t crn;
+    uint8_t opc1;
+    uint8_t crm;
+    uint8_t opc2;
+    uint8_t access;
+    uint32_t features;          /* all of them are required */
+    uint32_t excluded_features; /* any of them changes the register semantics */
+    int offset;
+} CP15RegInfo;
+
+#define CP15_REG(crn, opc1, crm, opc2, access, features, excluded, field) \
+    { crn, opc1, crm, opc2, access, features, excluded, offsetof(CPUState, cp15.field) }
+
+static const CP15RegInfo cp15_regs[] = {
+    CP15_REG(0,  0, 0,  0, CP15_R,  0, 0, c0_cpuid),     /* MIDR */
+    CP15_REG(0,  0, 0,  1, CP15_R,  0, 0, c0_cachetype), /* CTR */
+    CP15_REG(0,  2, 0,  0, CP15_R,  0, 0, c0_cssel),     /* CSSELR */
+    CP15_REG(1,  0, 0,  0, CP15_R,  0, 0, c1_sys),       /* SCTLR */
+    CP15_REG(1,  0, 0,  2, CP15_R,  0, CP15_FEATURE(XSCALE) | CP15_FEATURE(OMAPCP), c1_coproc), /* CPACR */
+    CP15_REG(2,  0, 0,  0, CP15_RW, 0, CP15_FEATURE(MPU), c2_base0),   /* TTBR0 */
+    CP15_REG(2,  0, 0,  1, CP15_RW, 0, CP15_FEATURE(MPU), c2_base1),   /* TTBR1 */
+    CP15_REG(2,  0, 0,  2, CP15_R,  0, CP15_FEATURE(MPU), c2_control), /* TTBCR */
+    CP15_REG(3,  0, 0,  0, CP15_R,  0, 0, c3),           /* DACR */
+    CP15_REG(5,  0, 0,  0, CP15_RW, 0, CP15_FEATURE(MPU), c5_data), /* DFSR */
+    CP15_REG(5,  0, 0,  1, CP15_RW, 0, CP15_FEATURE(MPU) | CP15_FEATURE(OMAPCP), c5_insn), /* IFSR */
+    CP15_REG(6,  0, 0,  0, CP15_RW, 0, CP15_FEATURE(MPU), c6_data), /* DFAR */
+    CP15_REG(6,  0, 0,  2, CP15_RW, CP15_FEATURE(V6), CP15_FEATURE(MPU) | CP15_FEATURE(OMAPCP), c6_insn), /* IFAR */
+    CP15_REG(7,  0, 4,  0, CP15_R,  0, 0, c7_par),       /* PAR */
+    CP15_REG(9,  0, 0,  0, CP15_RW, 0, CP15_FEATURE(OMAPCP) | CP15_FEATURE(STRONGARM), c9_data), /* L1 D lockdown */
+    CP15_REG(9,  0, 0,  1, CP15_RW, 0, CP15_FEATURE(OMAPCP) | CP15_FEATURE(STRONGARM), c9_insn), /* L1 I lockdown */
+    CP15_REG(9,  0, 12, 0, CP15_R,  CP15_FEATURE(V7), 0, c9_pmcr),      /* PMCR */
+    CP15_REG(9,  0, 13, 1, CP15_R,  CP15_FEATURE(V7), 0, c9_pmxevtyper), /* PMXEVTYPER */
+    CP15_REG(9,  0, 14, 0, CP15_R,  CP15_FEATURE(V7), 0, c9_pmuserenr), /* PMUSERENR */
+    CP15_REG(13, 0, 0,  0, CP15_R,  0, 0, c13_fcse),     /* FCSEIDR */
+    CP15_REG(13, 0, 0,  1, CP15_R,  0, 0, c13_context),  /* CONTEXTIDR */
+    CP15_REG(13, 0, 0,  2, CP15_RW, CP15_FEATURE(V6K), 0, c13_tls1), /* TPIDRURW */
+    CP15_REG(13, 0, 0,  3, CP15_RW, CP15_FEATURE(V6K), 0, c13_tls2), /* TPIDRURO */
+    CP15_REG(13, 0, 0,  4, CP15_RW, CP15_FEATURE(V6K), 0, c13_tls3), /* TPIDRPRW */
+};
+
+static const CP15RegInfo *cp15_find_reg(CPUState *env, uint32_t insn)
+{
+    unsigned int i;
+    int crn = (insn >> 16) & 0xf;
+    int opc1 = (insn >> 21) & 7;
+    int crm = insn & 0xf;
+    int opc2 = (insn >> 5) & 7;
+
+    for (i = 0; i < ARRAY_SIZE(cp15_regs); i++) {
+        const CP15RegInfo *ri = &cp15_regs[i];
+        if (ri->crn != crn || ri->opc1 != opc1 || ri->crm != crm || ri->opc2 != opc2) {
+            continue;
+        }
+        if ((env->features & ri->features) != ri->features || (env->features & ri->excluded_features)) {
+            return NULL;
+        }
+        return ri;
+    }
+    return NULL;
+}
+
+/* Generate an mrc/mcr of a plain storage register inline.  Return nonzero if
+   the access was handled.  */
+static int cp15_load_store(CPUState *env, DisasContext *s, uint32_t insn, uint32_t rd)
 {
     TCGv tmp;
-    int cpn = (insn >> 16) & 0xf;
-    int cpm = insn & 0xf;
-    int op = ((insn >> 5) & 7) | ((insn >> 18) & 0x38);
+    const CP15RegInfo *ri;
 
-    if (!arm_feature(env, ARM_FEATURE_V6K)) {
+    if (rd == 15) {
+        /* mrc to r15 sets condition codes, leave it to the helper */
         return 0;
     }
-
-    if (!(cpn == 13 && cpm == 0)) {
+    ri = cp15_find_reg(env, insn);
+    if (ri == NULL) {
         return 0;
     }
 
     if (insn & ARM_CP_RW_BIT) {
-        switch (op) {
-        case 2:
-            tmp = load_cpu_field(cp15.c13_tls1);
-            break;
-        case 3:
-            tmp = load_cpu_field(cp15.c13_tls2);
-            break;
-        case 4:
-            tmp = load_cpu_field(cp15.c13_tls3);
-            break;
-        default:
+        if (!(ri->access & CP15_R)) {
             return 0;
         }
+        tmp = load_cpu_offset(ri->offset);
         store_reg(s, rd, tmp);
-
     } else {
-        tmp = load_reg(s, rd);
-        switch (op) {
-        case 2:
-            store_cpu_field(tmp, cp15.c13_tls1);
-            break;
-        case 3:
-            store_cpu_field(tmp, cp15.c13_tls2);
-            break;
-        case 4:
-            store_cpu_field(tmp, cp15.c13_tls3);
-            break;
-        default:
-            tcg_temp_free_i32(tmp);
+        if (!(ri->access & CP15_W)) {
             return 0;
         }
+        tmp = load_reg(s, rd);
+        store_cpu_offset(tmp, ri->offset);
     }
     return 1;
 }
@@ -2655,7 +2721,8 @@ static int disas_cp15_insn(CPUState *env, DisasContext *s, uint32_t insn)
 
     rd = (insn >> 12) & 0xf;
 
-    if (cp15_tls_load_store(env, s, insn, rd)) {
+    /* mcr/mrc of a register without side effects */
+    if ((insn & (1 << 25)) && cp15_load_store(env, s, insn, rd)) {
         return 0;
     }
 
@@ -3682,12 +3749,22 @@ static inline void gen_goto_tb(DisasContext *s, int n, uint32_t dest)
     }
 }
 
-static inline void gen_jmp (DisasContext *s, uint32_t dest)
+static inline void gen_jmp_tb(DisasContext *s, uint32_t dest)
 {
     gen_goto_tb(s, 0, dest);
     s->base.is_jmp = DISAS_TB_JUMP;
 }
 
+static inline void gen_jmp (DisasContext *s, uint32_t dest)
+{
+    /* Unconditional jumps outside of IT blocks are translated through.  */
+    if (!s->condjmp && !s->condexec_mask && tb_superblock_continue(&s->base, s->base.pc, dest)) {
+        s->base.pc = dest;
+        return;
+    }
+    gen_jmp_tb(s, dest);
+}
+
 static inline void gen_mulxy(TCGv t0, TCGv t1, int x, int y)
 {
     if (x) {
@@ -6947,6 +7024,7 @@ static void disas_arm_insn(CPUState *env, DisasContext *s)
             val += (offset << 2) | ((insn >> 23) & 2) | 1;
             /* pipeline offset */
             val += 4;
+            gen_call_trace_calli(val & ~1, s->base.pc);
             /* protected by ARCH(5); above, near the start of uncond block */
             gen_bx_im(s, val);
             return;
@@ -7074,6 +7152,9 @@ static void disas_arm_insn(CPUState *env, DisasContext *s)
                 ARCH(4T);
                 tmp = load_reg(s, rm);
                 gen_bx(s, tmp);
+                if (rm == 14) {
+                    gen_call_trace_return(cpu_R[15]);
+                }
             } else if (op1 == 3) {
                 /* clz */
                 ARCH(5);
@@ -7107,6 +7188,7 @@ static void disas_arm_insn(CPUState *env, DisasContext *s)
             tcg_gen_movi_i32(tmp2, s->base.pc);
             store_reg(s, 14, tmp2);
             gen_bx(s, tmp);
+            gen_call_trace_call(cpu_R[15], s->base.pc);
             break;
         case 0x5: /* saturating add/subtract */
             ARCH(5TE);
@@ -8076,7 +8158,13 @@ do_ldst:
                 }
                 offset = (((int32_t)insn << 8) >> 8);
                 val += (offset << 2) + 4;
-                gen_jmp(s, val);
+                if (insn & (1 << 24)) {
+                    /* Calls end the block.  */
+                    gen_call_trace_calli(val, s->base.pc);
+                    gen_jmp_tb(s, val);
+                } else {
+                    gen_jmp(s, val);
+                }
             }
             break;
         case 0xc:
@@ -8221,6 +8309,7 @@ static int disas_thumb2_insn(CPUState *env, DisasContext *s, uint16_t insn_hw1)
             tcg_gen_movi_i32(tmp2, s->base.pc | 1);
             store_reg(s, 14, tmp2);
             gen_bx(s, tmp);
+            gen_call_trace_call(cpu_R[15], s->base.pc);
             return 0;
         }
         if (insn & (1 << 11)) {
@@ -8233,6 +8322,7 @@ static int disas_thumb2_insn(CPUState *env, DisasContext *s, uint16_t insn_hw1)
             tcg_gen_movi_i32(tmp2, s->base.pc | 1);
             store_reg(s, 14, tmp2);
             gen_bx(s, tmp);
+            gen_call_trace_call(cpu_R[15], s->base.pc);
             return 0;
         }
         if ((s->base.pc & ~TARGET_PAGE_MASK) == 0) {
@@ -8441,6 +8531,7 @@ static int disas_thumb2_insn(CPUState *env, DisasContext *s, uint16_t insn_hw1)
                         tmp = gen_ld32(addr, s->user);
                         if (i == 15) {
                             gen_bx(s, tmp);
+                            gen_call_trace_return(cpu_R[15]);
                         } else if (i == rn) {
                             loaded_var = tmp;
                             loaded_base = 1;
@@ -8837,10 +8928,17 @@ static int disas_thumb2_insn(CPUState *env, DisasContext *s, uint16_t insn_hw1)
                 offset += s->base.pc;
                 if (insn & (1 << 12)) {
                     /* b/bl */
-                    gen_jmp(s, offset);
+                    if (insn & (1 << 14)) {
+                        /* Calls end the block.  */
+                        gen_call_trace_calli(offset, s->base.pc);
+                        gen_jmp_tb(s, offset);
+                    } else {
+                        gen_jmp(s, offset);
+                    }
                 } else {
                     /* blx */
                     offset &= ~(uint32_t)2;
+                    gen_call_trace_calli(offset, s->base.pc);
                     /* thumb2 bx, no need to check */
                     gen_bx_im(s, offset);
                 }
@@ -9270,6 +9368,7 @@ static int disas_thumb2_insn(CPUState *env, DisasContext *s, uint16_t insn_hw1)
             }
             if (rs == 15) {
                 gen_bx(s, tmp);
+                gen_call_trace_return(cpu_R[15]);
             } else {
                 store_reg(s, rs, tmp);
             }
@@ -9458,6 +9557,11 @@ static void disas_thumb_insn(CPUState *env, DisasContext *s)
                 }
                 /* already thumb, no need to check */
                 gen_bx(s, tmp);
+                if (insn & (1 << 7)) {
+                    gen_call_trace_call(cpu_R[15], s->base.pc);
+                } else if (rm == 14) {
+                    gen_call_trace_return(cpu_R[15]);
+                }
                 break;
             }
             break;
@@ -10050,6 +10154,10 @@ void setup_disas_context(DisasContextBase *base, CPUState *env)
     dc->vfp_enabled = ARM_TBFLAG_VFPEN(dc->base.tb->flags);
     dc->vec_len = ARM_TBFLAG_VECLEN(dc->base.tb->flags);
     dc->vec_stride = ARM_TBFLAG_VECSTRIDE(dc->base.tb->flags);
+#ifdef TARGET_PROTO_ARM_M
+    dc->handler_mode = ARM_TBFLAG_HANDLER(dc->base.tb->flags);
+    dc->exception_return = 0;
+#endif
     cpu_F0s = tcg_temp_new_i32();
     cpu_F1s = tcg_temp_new_i32();
     cpu_F0d = tcg_temp_new_i64();
@@ -10110,6 +10218,11 @@ int gen_breakpoint(DisasContextBase *base, CPUBreakpoint *bp)
     return 1;
 }
 
+void gen_sync_guest_pc(DisasContextBase *base)
+{
+    gen_set_pc_im(base->pc);
+}
+
 /* generate intermediate code in gen_opc_buf and gen_opparam_buf for
    basic block 'tb'. If search_pc is TRUE, also generate PC
    information for each intermediate instruction. */
@@ -10124,6 +10237,14 @@ int gen_intermediate_code(CPUState *env, DisasContextBase *base)
 
     base->tb->size += disas_insn(env, (DisasContext *)base);
 
+#ifdef TARGET_PROTO_ARM_M
+    if (dc->exception_return) {
+        /* the stack restored by the exception return must not be
+           overwritten by the writeback of the instruction */
+        gen_helper_v7m_exception_return(cpu_env);
+        dc->exception_return = 0;
+    }
+#endif
     if (dc->condjmp && !dc->base.is_jmp) {
         gen_set_label(dc->condlabel);
         dc->condjmp = 0;
@@ -0,0 +1,38 @@
+/*
+ *  i386 interface functions.
+ *
+ *  Copyright (c) Antmicro
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include "cpu.h"
+
+/* Execute the x87 arithmetic and transcendental instructions on the host FPU
+   instead of softfloat.  This is much faster, but the results follow the
+   host FPU and libm rather than being bit-exact.  It has no effect on hosts
+   without an x87 FPU.  Takes effect from the next x87 instruction.  */
+void tlib_set_x87_host_fpu(uint32_t enabled)
+{
+    cpu->x87_host_fpu = !!enabled;
+}
+
+uint32_t tlib_get_x87_host_fpu(void)
+{
+#ifdef HOST_X87_FPU
+    return cpu->x87_host_fpu;
+#else
+    return 0;
+#endif
+}
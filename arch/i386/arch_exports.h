@@ -0,0 +1,9 @@
+#ifndef ARCH_EXPORTS_H_
+#define ARCH_EXPORTS_H_
+
+#include <stdint.h>
+
+void tlib_set_x87_host_fpu(uint32_t enabled);
+uint32_t tlib_get_x87_host_fpu(void);
+
+#endif
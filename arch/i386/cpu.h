@@ -39,6 +39,14 @@
 
 #include "softfloat.h"
 
+#include <float.h>
+
+/* the host FPU computes with the x87 extended precision format, so the guest
+   x87 instructions can optionally run on it instead of softfloat */
+#if (defined(__i386__) || defined(__x86_64__)) && LDBL_MANT_DIG == 64
+#define HOST_X87_FPU
+#endif
+
 #define R_EAX                        0
 #define R_ECX                        1
 #define R_EDX                        2
@@ -797,6 +805,11 @@ typedef struct CPUState {
        user */
     void *apic_state;
 
+    /* run the x87 arithmetic on the host FPU, see tlib_set_x87_host_fpu */
+    uint32_t x87_host_fpu;
+    uint16_t host_fpuc;       /* control word loaded for the current operation */
+    uint16_t host_fpuc_saved; /* host control word to restore after the operation */
+    uint16_t host_fpus;       /* host exception flags left by the last operation */
 } CPUState;
 
 void x86_cpudef_setup(void);
@@ -983,6 +996,11 @@ static inline bool cpu_has_work(CPUState *env)
            (env->interrupt_request & (CPU_INTERRUPT_NMI | CPU_INTERRUPT_INIT | CPU_INTERRUPT_SIPI | CPU_INTERRUPT_MCE));
 }
 
+/* called when the halted CPU has no work */
+static inline void cpu_idle(CPUState *env)
+{
+}
+
 #include "exec-all.h"
 
 static inline void cpu_pc_from_tb(CPUState *env, TranslationBlock *tb)
@@ -72,6 +72,8 @@ DEF_HELPER_2(boundl, void, tl, int)
 DEF_HELPER_0(rsm, void)
 DEF_HELPER_1(into, void, int)
 DEF_HELPER_1(cmpxchg8b, void, tl)
+DEF_HELPER_4(rep_movs, void, int, int, int, int)
+DEF_HELPER_3(rep_stos, void, int, int, int)
 #ifdef TARGET_X86_64
 DEF_HELPER_1(cmpxchg16b, void, tl)
 #endif
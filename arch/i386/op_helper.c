@@ -39,6 +39,8 @@ static inline target_long lshift(target_long x, int n)
 #define RC_UP   0x800
 #define RC_CHOP 0xc00
 
+#define PC_MASK 0x300
+
 #define MAXTAN  9223372036854775808.0
 
 /* the following deal with x86 long double-precision numbers */
@@ -1889,6 +1891,208 @@ void helper_cmpxchg16b(target_ulong a0)
 }
 #endif
 
+/* Bulk execution of rep movs/rep stos: the helpers process as many elements
+   as fit in the current source and destination pages, provided that those
+   pages are plain RAM present in the TLB. Anything else (IO, watchpoints,
+   pages with translated code, faults) is left to the per-element code
+   generated after the helper call. */
+static inline target_ulong string_op_addr_mask(int aflag)
+{
+    switch (aflag) {
+    case 0:
+        return 0xffff;
+    case 1:
+        return 0xffffffff;
+    default:
+        return (target_ulong)-1;
+    }
+}
+
+static inline void string_op_set_reg(int reg, target_ulong value, int aflag)
+{
+    switch (aflag) {
+    case 0:
+        env->regs[reg] = (env->regs[reg] & ~0xffff) | (value & 0xffff);
+        break;
+    case 1:
+        env->regs[reg] = (uint32_t)value;
+        break;
+    default:
+        env->regs[reg] = value;
+        break;
+    }
+}
+
+/* `offset` is already masked with the address size; like the translated accesses, the
+   32 and 16 bit addresses are truncated to 32 bits once the segment base is added */
+static inline target_ulong string_op_linear_addr(int seg, target_ulong offset, int aflag)
+{
+    target_ulong addr = offset;
+
+    if (seg >= 0) {
+        addr += env->segs[seg].base;
+    }
+    if (aflag != 2) {
+        addr = (uint32_t)addr;
+    }
+    return addr;
+}
+
+/* number of elements, starting at `addr` and moving in the `df` direction,
+   that stay within its page and do not wrap the index register */
+static target_ulong string_op_chunk(target_ulong addr, target_ulong reg, target_ulong amask, int size)
+{
+    target_ulong offset = addr & ~TARGET_PAGE_MASK;
+    target_ulong n, wrap;
+
+    if (offset + size > TARGET_PAGE_SIZE || amask - reg < size - 1) {
+        return 0;
+    }
+    if (env->df > 0) {
+        n = (TARGET_PAGE_SIZE - offset) / size;
+        wrap = (amask - reg - (size - 1)) / size + 1;
+    } else {
+        n = offset / size + 1;
+        wrap = reg / size + 1;
+    }
+    return n < wrap ? n : wrap;
+}
+
+/* host address of `addr` if its page is RAM mapped in the TLB without any flags */
+static uint8_t *string_op_host_ptr(target_ulong addr, int is_write)
+{
+    int mmu_idx = cpu_mmu_index(env);
+    int index = (addr >> TARGET_PAGE_BITS) & (CPU_TLB_SIZE - 1);
+    target_ulong tlb_addr = is_write ? env->tlb_table[mmu_idx][index].addr_write : env->tlb_table[mmu_idx][index].addr_read;
+
+    if ((addr & TARGET_PAGE_MASK) != tlb_addr) {
+        return NULL;
+    }
+    return (uint8_t *)(uintptr_t)(addr + env->tlb_table[mmu_idx][index].addend);
+}
+
+static inline int string_op_bulk_allowed(void)
+{
+    if (env->tlib_is_on_memory_access_enabled) {
+        return 0;
+    }
+    /* accesses of other cores have to be able to break reservations */
+    if (env->atomic_memory_state != NULL && env->atomic_memory_state->number_of_registered_cpus > 1) {
+        return 0;
+    }
+    return 1;
+}
+
+void helper_rep_movs(int ot, int aflag, int src_seg, int dst_seg)
+{
+    int size = 1 << ot;
+    target_ulong amask = string_op_addr_mask(aflag);
+    target_ulong count = ECX & amask;
+    target_ulong esi = ESI & amask;
+    target_ulong edi = EDI & amask;
+    target_ulong src, dst, n, bytes, i;
+    uint8_t *src_ptr, *dst_ptr;
+
+    if (!string_op_bulk_allowed()) {
+        return;
+    }
+    src = string_op_linear_addr(src_seg, esi, aflag);
+    dst = string_op_linear_addr(dst_seg, edi, aflag);
+    n = string_op_chunk(src, esi, amask, size);
+    if (n > string_op_chunk(dst, edi, amask, size)) {
+        n = string_op_chunk(dst, edi, amask, size);
+    }
+    if (n > count) {
+        n = count;
+    }
+    if (n == 0) {
+        return;
+    }
+    src_ptr = string_op_host_ptr(src, 0);
+    dst_ptr = string_op_host_ptr(dst, 1);
+    if (src_ptr == NULL || dst_ptr == NULL) {
+        return;
+    }
+
+    bytes = n * size;
+    if (env->df < 0) {
+        /* point to the lowest element of the block */
+        src_ptr -= bytes - size;
+        dst_ptr -= bytes - size;
+    }
+    if ((env->df > 0 && dst_ptr > src_ptr && dst_ptr < src_ptr + bytes) ||
+        (env->df < 0 && src_ptr > dst_ptr && src_ptr < dst_ptr + bytes)) {
+        /* overlapping copy in which elements read later were already written;
+           memmove would not reproduce that, so copy element by element */
+        uint8_t tmp[8];
+        for (i = 0; i < n; i++) {
+            target_ulong offset = (env->df > 0 ? i : n - 1 - i) * size;
+            memcpy(tmp, src_ptr + offset, size);
+            memcpy(dst_ptr + offset, tmp, size);
+        }
+    } else {
+        memmove(dst_ptr, src_ptr, bytes);
+    }
+
+    string_op_set_reg(R_ESI, esi + bytes * env->df, aflag);
+    string_op_set_reg(R_EDI, edi + bytes * env->df, aflag);
+    string_op_set_reg(R_ECX, count - n, aflag);
+}
+
+void helper_rep_stos(int ot, int aflag, int dst_seg)
+{
+    int size = 1 << ot;
+    target_ulong amask = string_op_addr_mask(aflag);
+    target_ulong count = ECX & amask;
+    target_ulong edi = EDI & amask;
+    target_ulong dst, n, bytes, i;
+    uint8_t *dst_ptr;
+
+    if (!string_op_bulk_allowed()) {
+        return;
+    }
+    dst = string_op_linear_addr(dst_seg, edi, aflag);
+    n = string_op_chunk(dst, edi, amask, size);
+    if (n > count) {
+        n = count;
+    }
+    if (n == 0) {
+        return;
+    }
+    dst_ptr = string_op_host_ptr(dst, 1);
+    if (dst_ptr == NULL) {
+        return;
+    }
+
+    bytes = n * size;
+    if (env->df < 0) {
+        dst_ptr -= bytes - size;
+    }
+    switch (size) {
+    case 1:
+        memset(dst_ptr, EAX & 0xff, bytes);
+        break;
+    case 2:
+        for (i = 0; i < bytes; i += size) {
+            stw_p(dst_ptr + i, EAX);
+        }
+        break;
+    case 4:
+        for (i = 0; i < bytes; i += size) {
+            stl_p(dst_ptr + i, EAX);
+        }
+        break;
+    default:
+        for (i = 0; i < bytes; i += size) {
+            stq_p(dst_ptr + i, EAX);
+        }
+        break;
+    }
+
+    string_op_set_reg(R_EDI, edi + bytes * env->df, aflag);
+    string_op_set_reg(R_ECX, count - n, aflag);
+}
+
 void helper_single_step(void)
 {
     check_hw_breakpoints(env, 1);
@@ -3406,6 +3610,84 @@ fail:
 
 /* x87 FPU helpers */
 
+static void fpu_set_exception(int mask)
+{
+    env->fpus |= mask;
+    if (env->fpus & (~env->fpuc & FPUC_EM)) {
+        env->fpus |= FPUS_SE | FPUS_B;
+    }
+}
+
+#ifdef HOST_X87_FPU
+/* With the host FPU fast path enabled, the x87 arithmetic and transcendental
+   instructions are executed on the host FPU with long doubles, which share
+   the layout of floatx80.  Each operation is bracketed by host_fpu_begin and
+   host_fpu_end, which load the guest rounding and precision control into the
+   host control word with all the host exceptions masked, report the raised
+   exceptions in the guest status word and restore the host control word, so
+   the guest settings never leak into the callbacks. */
+
+typedef union {
+    floatx80 f;
+    long double d;
+} HostLDoubleU;
+
+static inline long double floatx80_to_host(floatx80 a)
+{
+    HostLDoubleU u;
+
+    u.f = a;
+    return u.d;
+}
+
+static inline floatx80 host_to_floatx80(long double a)
+{
+    HostLDoubleU u;
+
+    u.d = a;
+    return u.f;
+}
+
+/* Return nonzero if the operation should run on the host FPU, in which case
+   host_fpu_end has to be called once it is done.  The transcendental
+   instructions ignore the precision control.  */
+static inline int host_fpu_begin(int extended)
+{
+    if (!env->x87_host_fpu) {
+        return 0;
+    }
+    env->host_fpuc = (env->fpuc & (RC_MASK | PC_MASK)) | FPUC_EM;
+    if (extended) {
+        env->host_fpuc |= PC_MASK;
+    }
+    asm volatile ("fnstcw %0" : "=m" (env->host_fpuc_saved));
+    if (env->host_fpuc_saved != env->host_fpuc) {
+        asm volatile ("fldcw %0" : : "m" (env->host_fpuc) : "memory");
+    }
+    /* the host exception flags are sticky like the guest ones and are only
+       cleared once the guest clears them, as fnclex is slow */
+    if (env->host_fpus & ~env->fpus) {
+        asm volatile ("fnclex" : : : "memory");
+        env->host_fpus = 0;
+    }
+    return 1;
+}
+
+static inline void host_fpu_end(void)
+{
+    uint16_t fpus;
+
+    asm volatile ("fnstsw %0" : "=m" (fpus));
+    env->host_fpus = fpus & (FPUS_IE | FPUS_DE | FPUS_ZE | FPUS_OE | FPUS_UE | FPUS_PE);
+    if (env->host_fpus & ~env->fpus) {
+        fpu_set_exception(env->host_fpus);
+    }
+    if (env->host_fpuc_saved != env->host_fpuc) {
+        asm volatile ("fldcw %0" : : "m" (env->host_fpuc_saved) : "memory");
+    }
+}
+#endif
+
 static inline double floatx80_to_double(floatx80 a)
 {
     union {
@@ -3428,12 +3710,43 @@ static inline floatx80 double_to_floatx80(double a)
     return float64_to_floatx80(u.f64, &env->fp_status);
 }
 
-static void fpu_set_exception(int mask)
+static inline floatx80 helper_fadd(floatx80 a, floatx80 b)
 {
-    env->fpus |= mask;
-    if (env->fpus & (~env->fpuc & FPUC_EM)) {
-        env->fpus |= FPUS_SE | FPUS_B;
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(0)) {
+        floatx80 r = host_to_floatx80(floatx80_to_host(a) + floatx80_to_host(b));
+
+        host_fpu_end();
+        return r;
+    }
+#endif
+    return floatx80_add(a, b, &env->fp_status);
+}
+
+static inline floatx80 helper_fsub(floatx80 a, floatx80 b)
+{
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(0)) {
+        floatx80 r = host_to_floatx80(floatx80_to_host(a) - floatx80_to_host(b));
+
+        host_fpu_end();
+        return r;
     }
+#endif
+    return floatx80_sub(a, b, &env->fp_status);
+}
+
+static inline floatx80 helper_fmul(floatx80 a, floatx80 b)
+{
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(0)) {
+        floatx80 r = host_to_floatx80(floatx80_to_host(a) * floatx80_to_host(b));
+
+        host_fpu_end();
+        return r;
+    }
+#endif
+    return floatx80_mul(a, b, &env->fp_status);
 }
 
 static inline floatx80 helper_fdiv(floatx80 a, floatx80 b)
@@ -3441,6 +3754,14 @@ static inline floatx80 helper_fdiv(floatx80 a, floatx80 b)
     if (floatx80_is_zero(b)) {
         fpu_set_exception(FPUS_ZE);
     }
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(0)) {
+        floatx80 r = host_to_floatx80(floatx80_to_host(a) / floatx80_to_host(b));
+
+        host_fpu_end();
+        return r;
+    }
+#endif
     return floatx80_div(a, b, &env->fp_status);
 }
 
@@ -3709,22 +4030,22 @@ void helper_fucomi_ST0_FT0(void)
 
 void helper_fadd_ST0_FT0(void)
 {
-    ST0 = floatx80_add(ST0, FT0, &env->fp_status);
+    ST0 = helper_fadd(ST0, FT0);
 }
 
 void helper_fmul_ST0_FT0(void)
 {
-    ST0 = floatx80_mul(ST0, FT0, &env->fp_status);
+    ST0 = helper_fmul(ST0, FT0);
 }
 
 void helper_fsub_ST0_FT0(void)
 {
-    ST0 = floatx80_sub(ST0, FT0, &env->fp_status);
+    ST0 = helper_fsub(ST0, FT0);
 }
 
 void helper_fsubr_ST0_FT0(void)
 {
-    ST0 = floatx80_sub(FT0, ST0, &env->fp_status);
+    ST0 = helper_fsub(FT0, ST0);
 }
 
 void helper_fdiv_ST0_FT0(void)
@@ -3741,22 +4062,22 @@ void helper_fdivr_ST0_FT0(void)
 
 void helper_fadd_STN_ST0(int st_index)
 {
-    ST(st_index) = floatx80_add(ST(st_index), ST0, &env->fp_status);
+    ST(st_index) = helper_fadd(ST(st_index), ST0);
 }
 
 void helper_fmul_STN_ST0(int st_index)
 {
-    ST(st_index) = floatx80_mul(ST(st_index), ST0, &env->fp_status);
+    ST(st_index) = helper_fmul(ST(st_index), ST0);
 }
 
 void helper_fsub_STN_ST0(int st_index)
 {
-    ST(st_index) = floatx80_sub(ST(st_index), ST0, &env->fp_status);
+    ST(st_index) = helper_fsub(ST(st_index), ST0);
 }
 
 void helper_fsubr_STN_ST0(int st_index)
 {
-    ST(st_index) = floatx80_sub(ST0, ST(st_index), &env->fp_status);
+    ST(st_index) = helper_fsub(ST0, ST(st_index));
 }
 
 void helper_fdiv_STN_ST0(int st_index)
@@ -3956,6 +4277,13 @@ void helper_fbst_ST0(target_ulong ptr)
 
 void helper_f2xm1(void)
 {
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(1)) {
+        ST0 = host_to_floatx80(exp2l(floatx80_to_host(ST0)) - 1.0L);
+        host_fpu_end();
+        return;
+    }
+#endif
     double val = floatx80_to_double(ST0);
     val = pow(2.0, val) - 1.0;
     ST0 = double_to_floatx80(val);
@@ -3963,6 +4291,21 @@ void helper_f2xm1(void)
 
 void helper_fyl2x(void)
 {
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(1)) {
+        long double fptemp = floatx80_to_host(ST0);
+
+        if (fptemp > 0.0L) {
+            ST1 = host_to_floatx80(log2l(fptemp) * floatx80_to_host(ST1));
+            fpop();
+        } else {
+            env->fpus &= (~0x4700);
+            env->fpus |= 0x400;
+        }
+        host_fpu_end();
+        return;
+    }
+#endif
     double fptemp = floatx80_to_double(ST0);
 
     if (fptemp > 0.0) {
@@ -3978,6 +4321,22 @@ void helper_fyl2x(void)
 
 void helper_fptan(void)
 {
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(1)) {
+        long double fptemp = floatx80_to_host(ST0);
+
+        if (fabsl(fptemp) > MAXTAN) {
+            env->fpus |= 0x400;
+        } else {
+            ST0 = host_to_floatx80(tanl(fptemp));
+            fpush();
+            ST0 = floatx80_one;
+            env->fpus &= (~0x400);  /* C2 <-- 0 */
+        }
+        host_fpu_end();
+        return;
+    }
+#endif
     double fptemp = floatx80_to_double(ST0);
 
     if ((fptemp > MAXTAN) || (fptemp < -MAXTAN)) {
@@ -3994,6 +4353,14 @@ void helper_fptan(void)
 
 void helper_fpatan(void)
 {
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(1)) {
+        ST1 = host_to_floatx80(atan2l(floatx80_to_host(ST1), floatx80_to_host(ST0)));
+        fpop();
+        host_fpu_end();
+        return;
+    }
+#endif
     double fptemp, fpsrcop;
 
     fpsrcop = floatx80_to_double(ST1);
@@ -4144,6 +4511,21 @@ void helper_fprem(void)
 
 void helper_fyl2xp1(void)
 {
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(1)) {
+        long double fptemp = floatx80_to_host(ST0);
+
+        if ((fptemp + 1.0L) > 0.0L) {
+            ST1 = host_to_floatx80(log2l(fptemp + 1.0L) * floatx80_to_host(ST1));
+            fpop();
+        } else {
+            env->fpus &= (~0x4700);
+            env->fpus |= 0x400;
+        }
+        host_fpu_end();
+        return;
+    }
+#endif
     double fptemp = floatx80_to_double(ST0);
 
     if ((fptemp + 1.0) > 0.0) {
@@ -4163,11 +4545,34 @@ void helper_fsqrt(void)
         env->fpus &= (~0x4700);  /* (C3,C2,C1,C0) <-- 0000 */
         env->fpus |= 0x400;
     }
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(0)) {
+        ST0 = host_to_floatx80(sqrtl(floatx80_to_host(ST0)));
+        host_fpu_end();
+        return;
+    }
+#endif
     ST0 = floatx80_sqrt(ST0, &env->fp_status);
 }
 
 void helper_fsincos(void)
 {
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(1)) {
+        long double fptemp = floatx80_to_host(ST0);
+
+        if (fabsl(fptemp) > MAXTAN) {
+            env->fpus |= 0x400;
+        } else {
+            ST0 = host_to_floatx80(sinl(fptemp));
+            fpush();
+            ST0 = host_to_floatx80(cosl(fptemp));
+            env->fpus &= (~0x400);  /* C2 <-- 0 */
+        }
+        host_fpu_end();
+        return;
+    }
+#endif
     double fptemp = floatx80_to_double(ST0);
 
     if ((fptemp > MAXTAN) || (fptemp < -MAXTAN)) {
@@ -4183,6 +4588,13 @@ void helper_fsincos(void)
 
 void helper_frndint(void)
 {
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(1)) {
+        ST0 = host_to_floatx80(rintl(floatx80_to_host(ST0)));
+        host_fpu_end();
+        return;
+    }
+#endif
     ST0 = floatx80_round_to_int(ST0, &env->fp_status);
 }
 
@@ -4198,6 +4610,20 @@ void helper_fscale(void)
 
 void helper_fsin(void)
 {
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(1)) {
+        long double fptemp = floatx80_to_host(ST0);
+
+        if (fabsl(fptemp) > MAXTAN) {
+            env->fpus |= 0x400;
+        } else {
+            ST0 = host_to_floatx80(sinl(fptemp));
+            env->fpus &= (~0x400);  /* C2 <-- 0 */
+        }
+        host_fpu_end();
+        return;
+    }
+#endif
     double fptemp = floatx80_to_double(ST0);
 
     if ((fptemp > MAXTAN) || (fptemp < -MAXTAN)) {
@@ -4211,6 +4637,20 @@ void helper_fsin(void)
 
 void helper_fcos(void)
 {
+#ifdef HOST_X87_FPU
+    if (host_fpu_begin(1)) {
+        long double fptemp = floatx80_to_host(ST0);
+
+        if (fabsl(fptemp) > MAXTAN) {
+            env->fpus |= 0x400;
+        } else {
+            ST0 = host_to_floatx80(cosl(fptemp));
+            env->fpus &= (~0x400);  /* C2 <-- 0 */
+        }
+        host_fpu_end();
+        return;
+    }
+#endif
     double fptemp = floatx80_to_double(ST0);
 
     if ((fptemp > MAXTAN) || (fptemp < -MAXTAN)) {
@@ -376,6 +376,29 @@ static inline void gen_op_jmp_T0(void)
     tcg_gen_st_tl(cpu_T[0], cpu_env, offsetof(CPUState, eip));
 }
 
+/* the call tracer works on linear addresses, T0 holds the new eip */
+static inline void gen_call_trace_call_T0(DisasContext *s, target_ulong next_eip)
+{
+    if (cpu->call_trace == NULL) {
+        return;
+    }
+    TCGv target = tcg_temp_new();
+    tcg_gen_addi_tl(target, cpu_T[0], s->cs_base);
+    gen_call_trace_call(target, s->cs_base + next_eip);
+    tcg_temp_free(target);
+}
+
+static inline void gen_call_trace_return_T0(DisasContext *s)
+{
+    if (cpu->call_trace == NULL) {
+        return;
+    }
+    TCGv target = tcg_temp_new();
+    tcg_gen_addi_tl(target, cpu_T[0], s->cs_base);
+    gen_call_trace_return(target);
+    tcg_temp_free(target);
+}
+
 static inline void gen_op_add_reg_im(int size, int reg, int32_t val)
 {
     switch (size) {
@@ -1224,8 +1247,62 @@ static inline void gen_repz_ ## op(DisasContext *s, int ot,                   \
     gen_jmp(s, cur_eip);                                                      \
 }
 
-GEN_REPZ(movs)
-GEN_REPZ(stos)
+/* rep movs and rep stos first let a helper process the elements that fit in
+   the current pages, then continue with a single iteration which takes care of
+   page crossings, faults and IO memory */
+#define GEN_REPZ_BULK(op)                                                     \
+static inline void gen_repz_ ## op(DisasContext *s, int ot,                   \
+                                 target_ulong cur_eip, target_ulong next_eip) \
+{                                                                             \
+    int l2;\
+    gen_update_cc_op(s);                                                      \
+    l2 = gen_jz_ecx_string(s, next_eip);                                      \
+    /* with single stepping every iteration has to be observable */           \
+    if (s->jmp_opt) {                                                         \
+        gen_bulk_ ## op(s, ot);                                               \
+        gen_op_jz_ecx(s->aflag, l2);                                          \
+    }                                                                         \
+    gen_ ## op(s, ot);                                                        \
+    gen_op_add_reg_im(s->aflag, R_ECX, -1);                                   \
+    if (!s->jmp_opt)                                                          \
+        gen_op_jz_ecx(s->aflag, l2);                                          \
+    gen_jmp(s, cur_eip);                                                      \
+}
+
+/* segment added to ESI by gen_string_movl_A0_ESI, -1 if none */
+static inline int gen_string_seg_ESI(DisasContext *s)
+{
+    if (s->aflag == 2) {
+        return s->override;
+    }
+    if (s->override < 0 && (s->addseg || !s->aflag)) {
+        return R_DS;
+    }
+    return s->override;
+}
+
+/* segment added to EDI by gen_string_movl_A0_EDI, -1 if none */
+static inline int gen_string_seg_EDI(DisasContext *s)
+{
+    if (s->aflag == 2 || (s->aflag && !s->addseg)) {
+        return -1;
+    }
+    return R_ES;
+}
+
+static inline void gen_bulk_movs(DisasContext *s, int ot)
+{
+    gen_helper_rep_movs(tcg_const_i32(ot), tcg_const_i32(s->aflag), tcg_const_i32(gen_string_seg_ESI(s)),
+                        tcg_const_i32(gen_string_seg_EDI(s)));
+}
+
+static inline void gen_bulk_stos(DisasContext *s, int ot)
+{
+    gen_helper_rep_stos(tcg_const_i32(ot), tcg_const_i32(s->aflag), tcg_const_i32(gen_string_seg_EDI(s)));
+}
+
+GEN_REPZ_BULK(movs)
+GEN_REPZ_BULK(stos)
 GEN_REPZ(lods)
 GEN_REPZ(ins)
 GEN_REPZ(outs)
@@ -2750,6 +2827,16 @@ static void gen_jmp(DisasContext *s, target_ulong eip)
     gen_jmp_tb(s, eip, 0);
 }
 
+/* unconditional relative jumps are translated through when possible */
+static void gen_jmp_rel(DisasContext *s, target_ulong eip)
+{
+    if (s->jmp_opt && tb_superblock_continue(&s->base, s->base.pc, s->cs_base + eip)) {
+        s->base.pc = s->cs_base + eip;
+        return;
+    }
+    gen_jmp(s, eip);
+}
+
 static inline void gen_ldq_env_A0(int idx, int offset)
 {
     int mem_idx = (idx >> 2) - 1;
@@ -4630,6 +4717,7 @@ case_0x83:
             gen_movtl_T1_im(next_eip);
             gen_push_T1(s);
             gen_op_jmp_T0();
+            gen_call_trace_call_T0(s, next_eip);
             gen_eob(s);
             break;
         case 3: /* lcall Ev */
@@ -6190,6 +6278,7 @@ do_shiftd:
             gen_op_andl_T0_ffff();
         }
         gen_op_jmp_T0();
+        gen_call_trace_return_T0(s);
         gen_eob(s);
         break;
     case 0xc3: /* ret */
@@ -6199,6 +6288,7 @@ do_shiftd:
             gen_op_andl_T0_ffff();
         }
         gen_op_jmp_T0();
+        gen_call_trace_return_T0(s);
         gen_eob(s);
         break;
     case 0xca: /* lret im */
@@ -6272,6 +6362,7 @@ do_lret:
         }
         gen_movtl_T0_im(next_eip);
         gen_push_T0(s);
+        gen_call_trace_calli(s->cs_base + tval, s->cs_base + next_eip);
         gen_jmp(s, tval);
     }
     break;
@@ -6302,7 +6393,7 @@ do_lret:
         } else if (!CODE64(s)) {
             tval &= 0xffffffff;
         }
-        gen_jmp(s, tval);
+        gen_jmp_rel(s, tval);
         break;
     case 0xea: /* ljmp im */
     {
@@ -6325,7 +6416,7 @@ do_lret:
         if (s->dflag == 0) {
             tval &= 0xffff;
         }
-        gen_jmp(s, tval);
+        gen_jmp_rel(s, tval);
         break;
     case 0x70 ... 0x7f:   /* jcc Jb */
         tval = (int8_t)insn_get(s, OT_BYTE);
@@ -7770,6 +7861,12 @@ int gen_breakpoint(DisasContextBase *base, CPUBreakpoint *bp)
     return 0;
 }
 
+void gen_sync_guest_pc(DisasContextBase *base)
+{
+    DisasContext *dc = (DisasContext *)base;
+    gen_jmp_im(dc->base.pc - dc->cs_base);
+}
+
 /* generate intermediate code in gen_opc_buf and gen_opparam_buf for
    basic block 'tb'. If search_pc is TRUE, also generate PC
    information for each intermediate instruction. */
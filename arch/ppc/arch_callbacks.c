@@ -28,4 +28,6 @@ DEFAULT_INT_HANDLER1(uint64_t tlib_read_decrementer, void)
 
 DEFAULT_VOID_HANDLER1(void tlib_write_decrementer, uint64_t value)
 
+DEFAULT_VOID_HANDLER1(void tlib_write_timebase, uint64_t value)
+
 DEFAULT_INT_HANDLER1(uint32_t tlib_is_vle_enabled, void)
@@ -8,5 +8,6 @@ uint32_t tlib_read_tbu(void);
 uint64_t tlib_read_decrementer(void);
 uint32_t tlib_is_vle_enabled(void);
 void tlib_write_decrementer(uint64_t value);
+void tlib_write_timebase(uint64_t value);
 
 #endif
@@ -19,6 +19,7 @@
  */
 #include <stdint.h>
 #include "cpu.h"
+#include "arch_callbacks.h"
 
 int32_t tlib_set_pending_interrupt(int32_t interruptNo, int32_t level)
 {
@@ -43,3 +44,68 @@ void tlib_set_little_endian_mode(bool mode)
         cpu->msr &= ~(1 << MSR_LE);
     }
 }
+
+// decode all the instructions with the VLE encoding, regardless of the VLE attribute of the pages
+void tlib_set_vle_enabled(uint32_t enabled)
+{
+    if (enabled) {
+        cpu->hflags_nmsr |= 1 << HFLAGS_VLE;
+        cpu->hflags |= 1 << HFLAGS_VLE;
+    } else {
+        cpu->hflags_nmsr &= ~(1 << HFLAGS_VLE);
+        cpu->hflags &= ~(1 << HFLAGS_VLE);
+    }
+}
+
+// when enabled, the time base and the decrementer are computed from the executed instructions count
+// and the decrementer exception is raised without calling `tlib_read_decrementer` or `tlib_write_decrementer`;
+// both continue from the values reported by the host at the moment of enabling
+// and are handed back with `tlib_write_timebase` and `tlib_write_decrementer` when disabling
+void tlib_set_native_timebase_enabled(uint32_t enabled)
+{
+    if (enabled && (cpu->excp_model == POWERPC_EXCP_BOOKE || cpu->excp_model == POWERPC_EXCP_40x)) {
+        // TCR/TSR and DECAR of the embedded timers are not modelled
+        tlib_printf(LOG_LEVEL_WARNING, "Native timebase is not supported on BookE and 40x cores, the host callbacks are used");
+        return;
+    }
+    if (enabled && !cpu->native_timebase_enabled) {
+        uint64_t tb = ((uint64_t)tlib_read_tbu() << 32) | tlib_read_tbl();
+        cpu_ppc_store_tb(cpu, tb);
+        cpu->native_timebase_enabled = 1;
+        // start from an already expired decrementer, so that taking over the host value
+        // does not look like a 0 -> 1 transition of its most significant bit
+        cpu->decrementer_deadline = tb - 1;
+        cpu_ppc_store_decr(cpu, (target_ulong)tlib_read_decrementer());
+    } else if (!enabled) {
+        if (cpu->native_timebase_enabled) {
+            tlib_write_timebase(cpu_ppc_load_tb(cpu));
+            tlib_write_decrementer((uint64_t)cpu_ppc_load_decr(cpu));
+        }
+        cpu->native_timebase_enabled = 0;
+        cpu->instructions_count_alarm = 0;
+    }
+}
+
+uint32_t tlib_get_native_timebase_enabled()
+{
+    return cpu->native_timebase_enabled;
+}
+
+// the time base advances by `multiplier` / `divider` ticks per executed instruction
+void tlib_set_timebase_frequency(uint32_t multiplier, uint32_t divider)
+{
+    if (multiplier == 0 || divider == 0) {
+        tlib_abortf("Invalid timebase frequency ratio: %u/%u", multiplier, divider);
+    }
+    cpu_ppc_set_tb_freq(cpu, multiplier, divider);
+}
+
+void tlib_set_timebase_value(uint64_t value)
+{
+    cpu_ppc_store_tb(cpu, value);
+}
+
+uint64_t tlib_get_timebase_value()
+{
+    return cpu_ppc_load_tb(cpu);
+}
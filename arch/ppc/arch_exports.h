@@ -5,5 +5,11 @@
 
 int32_t tlib_set_pending_interrupt(int32_t interruptNo, int32_t level);
 void tlib_set_little_endian_mode(bool mode);
+void tlib_set_vle_enabled(uint32_t enabled);
+void tlib_set_native_timebase_enabled(uint32_t enabled);
+uint32_t tlib_get_native_timebase_enabled(void);
+void tlib_set_timebase_frequency(uint32_t multiplier, uint32_t divider);
+void tlib_set_timebase_value(uint64_t value);
+uint64_t tlib_get_timebase_value(void);
 
 #endif
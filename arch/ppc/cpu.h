@@ -461,6 +461,9 @@ struct ppc_slb_t {
 #define MSR_RI               1  /* Recoverable interrupt                        1        */
 #define MSR_LE               0  /* Little-endian mode                           1 hflags */
 
+/* hflags bits not coming from the MSR, using positions of MSR bits that never get into the hflags */
+#define HFLAGS_VLE           1  /* VLE instruction encoding                              */
+
 #define msr_sf               ((env->msr >> MSR_SF)   & 1)
 #define msr_isf              ((env->msr >> MSR_ISF)  & 1)
 #define msr_shv              ((env->msr >> MSR_SHV)  & 1)
@@ -1000,11 +1003,25 @@ struct CPUState {
     /* Those resources are used only in Qemu core */
     target_ulong hflags;      /* hflags is a MSR & HFLAGS_MASK         */
     target_ulong hflags_nmsr; /* specific hflags, not coming from MSR */
+    /* BookE 2.06 page instructions were last fetched from and its VLE attribute */
+    target_ulong vle_page_base;
+    target_ulong vle_page_mask;
+    int vle_page;
     int mmu_idx;              /* precomputed MMU index to speed up mem accesses */
 
     /* Power management */
     int power_mode;
 
+    /* Time base and decrementer computed from the executed instructions count
+       instead of being read from the host:
+       TB = timebase_offset + instructions * timebase_multiplier / timebase_divider */
+    uint32_t native_timebase_enabled;
+    uint32_t timebase_multiplier;
+    uint32_t timebase_divider;
+    uint64_t timebase_offset;
+    /* time base value at which the decrementer reaches 0 */
+    uint64_t decrementer_deadline;
+
     /***************/
 
     CPU_COMMON
@@ -1131,11 +1148,19 @@ const ppc_def_t *cpu_ppc_find_by_name (const char *name);
 int cpu_ppc_register_internal (CPUState *env, const ppc_def_t *def);
 
 /* Time-base and decrementer management */
+uint64_t cpu_ppc_load_tb(CPUState *env);
+void cpu_ppc_store_tb(CPUState *env, uint64_t value);
+void cpu_ppc_set_tb_freq(CPUState *env, uint32_t multiplier, uint32_t divider);
+target_ulong cpu_ppc_load_decr(CPUState *env);
+void cpu_ppc_store_decr(CPUState *env, target_ulong value);
+void cpu_ppc_decr_alarm(CPUState *env);
+void cpu_ppc_skip_idle_time(CPUState *env);
 void booke206_flush_tlb(CPUState *env, int flags, const int check_iprot);
 target_phys_addr_t booke206_tlb_to_page_size(CPUState *env, ppcmas_tlb_t *tlb);
 int ppcemb_tlb_check(CPUState *env, ppcemb_tlb_t *tlb, target_phys_addr_t *raddrp, target_ulong address, uint32_t pid, int ext,
                      int i);
 int ppcmas_tlb_check(CPUState *env, ppcmas_tlb_t *tlb, target_phys_addr_t *raddrp, target_ulong address, uint32_t pid);
+int booke206_lookup_vle_page(CPUState *env, target_ulong address);
 #if defined(TARGET_PPC64)
 void ppc_slb_invalidate_all (CPUState *env);
 void ppc_slb_invalidate_one (CPUState *env, uint64_t T0);
@@ -1964,11 +1989,30 @@ enum {
 
 /*****************************************************************************/
 
+/* Forget the cached VLE attribute, the TLB or the address space changed */
+static inline void booke206_invalidate_vle_page(CPUState *env)
+{
+    env->vle_page_base = 1;
+    env->vle_page_mask = 0;
+}
+
+static inline int booke206_is_vle_page(CPUState *env, target_ulong address)
+{
+    if (likely((address & env->vle_page_mask) == env->vle_page_base)) {
+        return env->vle_page;
+    }
+    return booke206_lookup_vle_page(env, address);
+}
+
 static inline void cpu_get_tb_cpu_state(CPUState *env, target_ulong *pc, target_ulong *cs_base, int *flags)
 {
     *pc = env->nip;
     *cs_base = 0;
     *flags = env->hflags;
+    /* On BookE 2.06 the instruction encoding is an attribute of the page */
+    if (env->mmu_model == POWERPC_MMU_BOOKE206 && booke206_is_vle_page(env, env->nip)) {
+        *flags |= 1 << HFLAGS_VLE;
+    }
 }
 
 static inline int booke206_tlbm_id(CPUState *env, ppcmas_tlb_t *tlbm)
@@ -2045,6 +2089,16 @@ static inline bool cpu_has_work(CPUState *env)
     return msr_ee && (env->interrupt_request & CPU_INTERRUPT_HARD);
 }
 
+/* called when the halted CPU has no work */
+static inline void cpu_idle(CPUState *env)
+{
+    /* with the native time base only the decrementer can wake up the CPU,
+       but it is not taken with external interrupts disabled */
+    if (msr_ee) {
+        cpu_ppc_skip_idle_time(env);
+    }
+}
+
 #include "exec-all.h"
 
 static inline void cpu_pc_from_tb(CPUState *env, TranslationBlock *tb)
@@ -1035,6 +1035,7 @@ void booke206_flush_tlb(CPUState *env, int flags, const int check_iprot)
         tlb += booke206_tlb_size(env, i);
     }
 
+    booke206_invalidate_vle_page(env);
     tlb_flush(env, 1);
 }
 
@@ -1155,6 +1156,34 @@ found_tlb:
     return ret;
 }
 
+/* Find the VLE attribute of the page containing the address and cache it for
+   the next lookups. Addresses not mapped by any TLB entry use the standard
+   encoding. */
+int booke206_lookup_vle_page(CPUState *env, target_ulong address)
+{
+    ppcmas_tlb_t *tlb;
+    target_phys_addr_t raddr;
+    int i, j, prot;
+
+    for (i = 0; i < BOOKE206_MAX_TLBN; i++) {
+        int ways = booke206_tlb_ways(env, i);
+
+        for (j = 0; j < ways; j++) {
+            tlb = booke206_get_tlbm(env, i, address, j);
+            if (mmubooke206_check_tlb(env, tlb, &raddr, &prot, address, 0, ACCESS_CODE) != -1) {
+                env->vle_page_mask = ~(booke206_tlb_to_page_size(env, tlb) - 1);
+                env->vle_page_base = address & env->vle_page_mask;
+                env->vle_page = !!(tlb->mas2 & MAS2_VLE);
+                return env->vle_page;
+            }
+        }
+    }
+    env->vle_page_mask = (target_ulong)TARGET_PAGE_MASK;
+    env->vle_page_base = address & TARGET_PAGE_MASK;
+    env->vle_page = 0;
+    return 0;
+}
+
 static int mmubooke206_get_physical_address(CPUState *env, mmu_ctx_t *mmu_ctx, target_ulong address, int rw, int access_type)
 {
     ppcmas_tlb_t *tlb;
@@ -2467,6 +2496,131 @@ store_next:
     }
 }
 
+/*****************************************************************************/
+/* Time-base and decrementer management */
+
+/* timebase ticks elapsed after `instructions`; split so that the product does not overflow */
+static inline uint64_t instructions_to_ticks(CPUState *env, uint64_t instructions)
+{
+    return (instructions / env->timebase_divider) * env->timebase_multiplier +
+           (instructions % env->timebase_divider) * env->timebase_multiplier / env->timebase_divider;
+}
+
+/* smallest number of instructions after which `ticks` have elapsed */
+static inline uint64_t ticks_to_instructions(CPUState *env, uint64_t ticks)
+{
+    return (ticks / env->timebase_multiplier) * env->timebase_divider +
+           ((ticks % env->timebase_multiplier) * env->timebase_divider + env->timebase_multiplier - 1) / env->timebase_multiplier;
+}
+
+uint64_t cpu_ppc_load_tb(CPUState *env)
+{
+    return env->timebase_offset + instructions_to_ticks(env, env->instructions_count_total_value);
+}
+
+static inline int ppc_large_decrementer(CPUState *env)
+{
+    return (env->spr[SPR_LPCR] & LPCR_LD) != 0;
+}
+
+static inline int64_t ppc_decr_value(CPUState *env, uint64_t decr)
+{
+    return ppc_large_decrementer(env) ? (int64_t)decr : (int32_t)decr;
+}
+
+/* schedule the decrementer exception for the moment the time base passes the deadline */
+static void ppc_arm_decr_alarm(CPUState *env)
+{
+    if (!env->native_timebase_enabled) {
+        /* the host schedules the decrementer */
+        env->instructions_count_alarm = 0;
+        return;
+    }
+    if (ppc_decr_value(env, env->decrementer_deadline - cpu_ppc_load_tb(env)) < 0) {
+        env->instructions_count_alarm = 0;
+        return;
+    }
+
+    uint64_t ticks = env->decrementer_deadline + 1 - env->timebase_offset;
+    uint64_t alarm = ticks_to_instructions(env, ticks);
+    env->instructions_count_alarm = alarm != 0 ? alarm : 1;
+}
+
+void cpu_ppc_store_tb(CPUState *env, uint64_t value)
+{
+    /* keep the decrementer value unchanged */
+    int64_t decr = env->decrementer_deadline - cpu_ppc_load_tb(env);
+
+    env->timebase_offset = value - instructions_to_ticks(env, env->instructions_count_total_value);
+    env->decrementer_deadline = value + decr;
+    ppc_arm_decr_alarm(env);
+}
+
+void cpu_ppc_set_tb_freq(CPUState *env, uint32_t multiplier, uint32_t divider)
+{
+    uint64_t tb = cpu_ppc_load_tb(env);
+
+    env->timebase_multiplier = multiplier;
+    env->timebase_divider = divider;
+    /* the time base continues from its current value at the new rate */
+    env->timebase_offset = tb - instructions_to_ticks(env, env->instructions_count_total_value);
+    ppc_arm_decr_alarm(env);
+}
+
+target_ulong cpu_ppc_load_decr(CPUState *env)
+{
+    uint64_t decr = env->decrementer_deadline - cpu_ppc_load_tb(env);
+
+    if (!ppc_large_decrementer(env)) {
+        decr = (uint32_t)decr;
+    }
+    return (target_ulong)decr;
+}
+
+void cpu_ppc_store_decr(CPUState *env, target_ulong value)
+{
+    int64_t old_decr = ppc_decr_value(env, cpu_ppc_load_decr(env));
+    int64_t new_decr = ppc_decr_value(env, value);
+    uint64_t now = cpu_ppc_load_tb(env);
+
+    env->decrementer_deadline = now + new_decr;
+    if (new_decr < 0) {
+        /* the decrementer exception is signalled when its most significant bit goes from 0 to 1 */
+        env->instructions_count_alarm = 0;
+        if (old_decr >= 0) {
+            env->pending_interrupts |= 1 << PPC_INTERRUPT_DECR;
+            env->interrupt_request |= CPU_INTERRUPT_HARD;
+        }
+        return;
+    }
+    ppc_arm_decr_alarm(env);
+}
+
+void cpu_ppc_decr_alarm(CPUState *env)
+{
+    if (env->native_timebase_enabled && ppc_decr_value(env, cpu_ppc_load_decr(env)) < 0) {
+        env->pending_interrupts |= 1 << PPC_INTERRUPT_DECR;
+        env->interrupt_request |= CPU_INTERRUPT_HARD;
+    }
+}
+
+/* No instructions are executed while the CPU sleeps, so the time base would
+   never reach the decrementer deadline; skip the idle time up to it instead.  */
+void cpu_ppc_skip_idle_time(CPUState *env)
+{
+    int64_t ticks;
+
+    if (!env->native_timebase_enabled || env->instructions_count_alarm == 0) {
+        return;
+    }
+    ticks = env->decrementer_deadline + 1 - cpu_ppc_load_tb(env);
+    if (ticks > 0) {
+        env->timebase_offset += ticks;
+    }
+    env->instructions_count_alarm = 0;
+    cpu_ppc_decr_alarm(env);
+}
+
 void do_interrupt (CPUState *env)
 {
     powerpc_excp(env, env->excp_model, env->exception_index);
@@ -2596,6 +2750,8 @@ void cpu_reset(CPUState *env)
     env->pending_interrupts = 0;
     env->exception_index = POWERPC_EXCP_NONE;
     env->error_code = 0;
+    env->instructions_count_alarm = 0;
+    env->interrupt_request &= ~CPU_INTERRUPT_ALARM;
     /* Flush all TLBs */
     tlb_flush(env, 1);
 }
@@ -2608,6 +2764,13 @@ int cpu_init (const char *cpu_model)
         return -1;
     }
     cpu_ppc_register_internal(cpu, def);
+    cpu->timebase_multiplier = 1;
+    cpu->timebase_divider = 1;
+    /* the host decides on the encoding once, pages can still override it on BookE 2.06 */
+    if (tlib_is_vle_enabled()) {
+        cpu->hflags_nmsr |= 1 << HFLAGS_VLE;
+        hreg_compute_hflags(cpu);
+    }
     return 0;
 }
 
@@ -61,6 +61,8 @@ static inline void hreg_compute_hflags(CPUState *env)
     env->hflags = env->msr & hflags_mask;
     /* Merge with hflags coming from other registers */
     env->hflags |= env->hflags_nmsr;
+    /* The address space used to fetch instructions might have changed */
+    booke206_invalidate_vle_page(env);
 }
 
 static inline int hreg_store_msr(CPUState *env, target_ulong value, int alter_hv)
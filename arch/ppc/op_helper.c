@@ -44,11 +44,17 @@ void helper_raise_exception (uint32_t exception)
 /* SPR accesses */
 target_ulong helper_load_tbl (void)
 {
+    if (env->native_timebase_enabled) {
+        return (target_ulong)cpu_ppc_load_tb(env);
+    }
     return tlib_read_tbl();
 }
 
 target_ulong helper_load_tbu (void)
 {
+    if (env->native_timebase_enabled) {
+        return cpu_ppc_load_tb(env) >> 32;
+    }
     return tlib_read_tbu();
 }
 
@@ -94,10 +100,16 @@ void helper_store_sdr1 (target_ulong val)
 
 void helper_store_tbl (target_ulong val)
 {
+    if (env->native_timebase_enabled) {
+        cpu_ppc_store_tb(env, (cpu_ppc_load_tb(env) & 0xFFFFFFFF00000000ULL) | (uint32_t)val);
+    }
 }
 
 void helper_store_tbu (target_ulong val)
 {
+    if (env->native_timebase_enabled) {
+        cpu_ppc_store_tb(env, ((uint64_t)(uint32_t)val << 32) | (uint32_t)cpu_ppc_load_tb(env));
+    }
 }
 
 void helper_store_atbl (target_ulong val)
@@ -122,6 +134,9 @@ void helper_store_601_rtcu (target_ulong val)
 
 target_ulong helper_load_decr (void)
 {
+    if (env->native_timebase_enabled) {
+        return cpu_ppc_load_decr(env);
+    }
     return (target_ulong)tlib_read_decrementer();
 }
 
@@ -134,6 +149,10 @@ void helper_store_decr (target_ulong val)
         tlib_printf(LOG_LEVEL_WARNING, "Trying to write decrementer value that does not fit in 32 bits. Ignoring higher bits.");
         val = (uint32_t)val;
     }
+    if (env->native_timebase_enabled) {
+        cpu_ppc_store_decr(env, val);
+        return;
+    }
     tlib_write_decrementer((uint64_t)val);
 }
 
@@ -4120,6 +4139,7 @@ void helper_booke_setpid(uint32_t pidn, target_ulong pid)
 {
     env->spr[pidn] = pid;
     /* changing PIDs mean we're in a different address space now */
+    booke206_invalidate_vle_page(env);
     tlb_flush(env, 1);
 }
 
@@ -4170,6 +4190,7 @@ void helper_booke206_tlbwe(void)
         tlb->mas1 &= ~MAS1_IPROT;
     }
 
+    booke206_invalidate_vle_page(env);
     if (booke206_tlb_to_page_size(env, tlb) == TARGET_PAGE_SIZE) {
         tlb_flush_page(env, tlb->mas2 & MAS2_EPN_MASK);
     } else {
@@ -4263,6 +4284,7 @@ static inline void booke206_invalidate_ea_tlb(CPUState *env, int tlbn, uint32_t
             tlb->mas1 &= ~MAS1_VALID;
         }
     }
+    booke206_invalidate_vle_page(env);
 }
 
 void helper_booke206_tlbivax(target_ulong address)
@@ -3283,6 +3283,19 @@ static void gen_b(DisasContext *s)
     }
     if (LK(s->opcode)) {
         gen_setlr(s, s->base.pc);
+        gen_call_trace_calli(target, s->base.pc);
+    } else {
+#if defined(TARGET_PPC64)
+        if (!s->sf_mode) {
+            target = (uint32_t)target;
+        }
+#endif
+        /* Branches that do not link are translated through.  */
+        if (tb_superblock_continue(&s->base, s->base.pc, target)) {
+            s->exception = POWERPC_EXCP_NONE;
+            s->base.pc = target;
+            return;
+        }
     }
     gen_goto_tb(s, 0, target);
 }
@@ -3351,10 +3364,12 @@ static inline void gen_bcond(DisasContext *s, int type)
     if (type == BCOND_IM) {
         target_ulong li = (target_long)((int16_t)(BD(s->opcode)));
         if (likely(AA(s->opcode) == 0)) {
-            gen_goto_tb(s, 0, s->base.pc + li - 4);
-        } else {
-            gen_goto_tb(s, 0, li);
+            li += s->base.pc - 4;
         }
+        if (LK(s->opcode)) {
+            gen_call_trace_calli(li, s->base.pc);
+        }
+        gen_goto_tb(s, 0, li);
         gen_set_label(l1);
         gen_goto_tb(s, 1, s->base.pc);
     } else {
@@ -3364,6 +3379,11 @@ static inline void gen_bcond(DisasContext *s, int type)
         } else
 #endif
         tcg_gen_andi_tl(cpu_nip, target, ~3);
+        if (LK(s->opcode)) {
+            gen_call_trace_call(cpu_nip, s->base.pc);
+        } else if (type == BCOND_LR) {
+            gen_call_trace_return(cpu_nip);
+        }
         gen_exit_tb_no_chaining(s->base.tb);
         gen_set_label(l1);
 #if defined(TARGET_PPC64)
@@ -9742,7 +9762,7 @@ void setup_disas_context(DisasContextBase *base, CPUState *env)
     dc->has_cfar = !!(env->flags & POWERPC_FLAG_CFAR);
 #endif
     dc->fpu_enabled = msr_fp;
-    dc->vle_enabled = tlib_is_vle_enabled();
+    dc->vle_enabled = (base->tb->flags >> HFLAGS_VLE) & 1;
     if ((env->flags & POWERPC_FLAG_SPE) && msr_spe) {
         dc->spe_enabled = msr_spe;
     } else {
@@ -9761,6 +9781,11 @@ int gen_breakpoint(DisasContextBase *base, CPUBreakpoint *bp)
     return 1;
 }
 
+void gen_sync_guest_pc(DisasContextBase *base)
+{
+    gen_update_nip((DisasContext *)base, base->pc);
+}
+
 /*****************************************************************************/
 int gen_intermediate_code(CPUState *env, DisasContextBase *base)
 {
@@ -9806,6 +9831,12 @@ int process_interrupt(int interrupt_request, CPUState *env)
         return 0;
     }
 
+    if (interrupt_request & CPU_INTERRUPT_ALARM) {
+        env->interrupt_request &= ~CPU_INTERRUPT_ALARM;
+        cpu_ppc_decr_alarm(env);
+        interrupt_request = env->interrupt_request;
+    }
+
     if (interrupt_request & CPU_INTERRUPT_HARD) {
         ppc_hw_interrupt(env);
         if (env->pending_interrupts == 0) {
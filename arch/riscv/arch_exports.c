@@ -77,10 +77,59 @@ void tlib_set_privilege_architecture(int32_t privilege_architecture)
     if (privilege_architecture > RISCV_PRIV1_11) {
         tlib_abort("Invalid privilege architecture set. Highest suppported version is 1.11");
     }
+    if (cpu->privilege_architecture != privilege_architecture) {
+        // inline CSR reads are translated for the current CSR numbering
+        tb_flush(cpu);
+    }
     cpu->privilege_architecture = privilege_architecture;
 }
 
-uint64_t tlib_install_custom_instruction(uint64_t mask, uint64_t pattern, uint64_t length)
+static int validate_custom_instruction_ops(uint64_t length, uint64_t *ops, uint32_t ops_count)
+{
+    uint64_t bits = length * 8;
+    uint32_t i;
+
+    if (ops_count == 0 || ops_count > CUSTOM_INSTRUCTION_OPS_LIMIT) {
+        tlib_printf(LOG_LEVEL_WARNING, "Custom instruction must consist of 1 to %d ops, got %d", CUSTOM_INSTRUCTION_OPS_LIMIT, ops_count);
+        return 0;
+    }
+
+    for (i = 0; i < ops_count; i++) {
+        uint64_t *op = &ops[i * CUSTOM_INSTRUCTION_OP_WORDS];
+        uint64_t dst = op[1], src1 = op[2], src2 = op[3];
+        int valid;
+
+        switch (op[0]) {
+        case CI_OP_MOVI:
+            valid = dst < CUSTOM_INSTRUCTION_TEMPS;
+            break;
+        case CI_OP_EXTRACT:
+        case CI_OP_SEXTRACT:
+            valid = dst < CUSTOM_INSTRUCTION_TEMPS && src2 > 0 && src2 <= 64 && src1 < bits && src2 <= bits - src1;
+            break;
+        case CI_OP_READ_GPR:
+            valid = dst < CUSTOM_INSTRUCTION_TEMPS && src1 + 5 <= bits;
+            break;
+        case CI_OP_WRITE_GPR:
+            valid = dst + 5 <= bits && src1 < CUSTOM_INSTRUCTION_TEMPS;
+            break;
+        case CI_OP_ADD ... CI_OP_SLTU:
+            valid = dst < CUSTOM_INSTRUCTION_TEMPS && src1 < CUSTOM_INSTRUCTION_TEMPS && src2 < CUSTOM_INSTRUCTION_TEMPS;
+            break;
+        default:
+            valid = 0;
+            break;
+        }
+
+        if (!valid) {
+            tlib_printf(LOG_LEVEL_WARNING, "Invalid custom instruction op #%d (opcode %d)", i, (int)op[0]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint64_t install_custom_instruction(uint64_t mask, uint64_t pattern, uint64_t length, uint64_t *ops, uint32_t ops_count)
 {
     if (cpu->custom_instructions_count == CPU_CUSTOM_INSTRUCTIONS_LIMIT) {
         // no more empty slots
@@ -93,10 +142,46 @@ uint64_t tlib_install_custom_instruction(uint64_t mask, uint64_t pattern, uint64
     ci->mask = mask;
     ci->pattern = pattern;
     ci->length = length;
+    ci->ops = ops;
+    ci->ops_count = ops_count;
+
+    // register the descriptor in every major opcode bucket it can match,
+    // so that the decoder only has to look at the candidates for a given opcode
+    int index = ci->id - 1;
+    int major;
+    for (major = 0; major < CUSTOM_INSTRUCTION_BUCKETS; major++) {
+        if ((major & mask & CUSTOM_INSTRUCTION_BUCKET_MASK) == (pattern & mask & CUSTOM_INSTRUCTION_BUCKET_MASK)) {
+            cpu->custom_instruction_buckets[major][index / 64] |= 1ULL << (index % 64);
+        }
+    }
 
     return ci->id;
 }
 
+uint64_t tlib_install_custom_instruction(uint64_t mask, uint64_t pattern, uint64_t length)
+{
+    return install_custom_instruction(mask, pattern, length, NULL, 0);
+}
+
+// installs a custom instruction whose semantics are given as micro-ops (see CI_OP_* in cpu.h);
+// it is translated into TCG code and executed without calling `tlib_handle_custom_instruction`
+uint64_t tlib_install_custom_instruction_ops(uint64_t mask, uint64_t pattern, uint64_t length, uint64_t *ops, uint32_t ops_count)
+{
+    if (!validate_custom_instruction_ops(length, ops, ops_count)) {
+        return 0;
+    }
+
+    size_t size = sizeof(uint64_t) * CUSTOM_INSTRUCTION_OP_WORDS * ops_count;
+    uint64_t *ops_copy = tlib_malloc(size);
+    memcpy(ops_copy, ops, size);
+
+    uint64_t id = install_custom_instruction(mask, pattern, length, ops_copy, ops_count);
+    if (id == 0) {
+        tlib_free(ops_copy);
+    }
+    return id;
+}
+
 void helper_wfi(CPUState *env);
 void tlib_enter_wfi()
 {
@@ -109,6 +194,10 @@ void tlib_set_csr_validation_level(uint32_t value)
         case CSR_VALIDATION_FULL:
         case CSR_VALIDATION_PRIV:
         case CSR_VALIDATION_NONE:
+            if (cpu->csr_validation_level != value) {
+                // inline CSR reads are translated for the current validation level
+                tb_flush(cpu);
+            }
             cpu->csr_validation_level = value;
             break;
 
@@ -122,6 +211,13 @@ uint32_t tlib_get_csr_validation_level()
     return cpu->csr_validation_level;
 }
 
+// has to be called when `tlib_has_nonstandard_csr` starts or stops reporting `csr`,
+// the CSR reads translated inline only check it at translation time
+void tlib_nonstandard_csr_changed(uint64_t csr)
+{
+    tb_flush(cpu);
+}
+
 void tlib_set_nmi_vector(uint64_t nmi_adress, uint32_t nmi_length)
 {
     if (nmi_adress > (TARGET_ULONG_MAX - nmi_length)) {
@@ -11,10 +11,14 @@ uint32_t tlib_is_feature_allowed(uint32_t feature_bit);
 
 void tlib_set_privilege_architecture(int32_t privilege_architecture);
 
+void tlib_nonstandard_csr_changed(uint64_t csr);
+
 void tlib_set_nmi_vector(uint64_t nmi_adress, uint32_t nmi_lenght);
 
 void tlib_set_nmi(int32_t nmi, int32_t state);
 
 void tlib_allow_unaligned_accesses(int32_t allowed);
 
+uint64_t tlib_install_custom_instruction_ops(uint64_t mask, uint64_t pattern, uint64_t length, uint64_t *ops, uint32_t ops_count);
+
 #endif
@@ -44,9 +44,54 @@ typedef struct custom_instruction_descriptor_t {
     uint64_t length;
     uint64_t mask;
     uint64_t pattern;
+    /* semantics translated inline instead of calling the host handler;
+       `ops_count` entries of CUSTOM_INSTRUCTION_OP_WORDS words each, NULL if not set */
+    uint64_t *ops;
+    uint32_t ops_count;
 } custom_instruction_descriptor_t;
 #define CPU_CUSTOM_INSTRUCTIONS_LIMIT 256
 
+/* Inline custom instructions are described by a sequence of micro-ops
+   operating on a small set of temporaries. Each op is encoded as
+   { opcode, dst, src1, src2 } where:
+ * CI_OP_MOVI:     t[dst] = src1
+ * CI_OP_EXTRACT:  t[dst] = zero-extended field of src2 bits at position src1 of the instruction
+ * CI_OP_SEXTRACT: t[dst] = sign-extended field of src2 bits at position src1 of the instruction
+ * CI_OP_READ_GPR: t[dst] = x[5-bit register index at position src1 of the instruction]
+ * CI_OP_WRITE_GPR: x[5-bit register index at position dst of the instruction] = t[src1]
+ * CI_OP_ADD ... CI_OP_SLTU: t[dst] = t[src1] <op> t[src2]; shift amounts are truncated to XLEN
+ */
+enum {
+    CI_OP_MOVI      = 0,
+    CI_OP_EXTRACT   = 1,
+    CI_OP_SEXTRACT  = 2,
+    CI_OP_READ_GPR  = 3,
+    CI_OP_WRITE_GPR = 4,
+    CI_OP_ADD       = 5,
+    CI_OP_SUB       = 6,
+    CI_OP_AND       = 7,
+    CI_OP_OR        = 8,
+    CI_OP_XOR       = 9,
+    CI_OP_SHL       = 10,
+    CI_OP_SHR       = 11,
+    CI_OP_SAR       = 12,
+    CI_OP_MUL       = 13,
+    CI_OP_SLT       = 14,
+    CI_OP_SLTU      = 15,
+    CI_OP_COUNT
+};
+#define CUSTOM_INSTRUCTION_OP_WORDS 4
+#define CUSTOM_INSTRUCTION_OPS_LIMIT 64
+#define CUSTOM_INSTRUCTION_TEMPS 8
+
+// custom instructions are bucketed by the major opcode (bits [6:0]);
+// each bucket is a bitmap of descriptor indices that can match it
+#define CUSTOM_INSTRUCTION_BUCKET_BITS 7
+#define CUSTOM_INSTRUCTION_BUCKETS     (1 << CUSTOM_INSTRUCTION_BUCKET_BITS)
+#define CUSTOM_INSTRUCTION_BUCKET_MASK (CUSTOM_INSTRUCTION_BUCKETS - 1)
+#define CUSTOM_INSTRUCTION_BUCKET_WORDS (CPU_CUSTOM_INSTRUCTIONS_LIMIT / 64)
+typedef uint64_t custom_instruction_bucket_t[CUSTOM_INSTRUCTION_BUCKET_WORDS];
+
 typedef struct DisasContext {
     struct DisasContextBase base;
     uint64_t opcode;
@@ -84,6 +129,8 @@ struct CPUState {
     target_ulong mip;
     target_ulong mie;
     target_ulong mideleg;
+    /* mie filtered by priv, delegation and mstatus.xIE; see riscv_update_interrupt_mask */
+    target_ulong interrupt_enable_mask;
 
     target_ulong sptbr;  /* until: priv-1.9.1;  replaced by satp */
     target_ulong medeleg;
@@ -155,6 +202,7 @@ struct CPUState {
 
     int32_t custom_instructions_count;
     custom_instruction_descriptor_t custom_instructions[CPU_CUSTOM_INSTRUCTIONS_LIMIT];
+    custom_instruction_bucket_t custom_instruction_buckets[CUSTOM_INSTRUCTION_BUCKETS];
 
     /*
        Supported CSR validation levels:
@@ -200,6 +248,7 @@ static inline int cpu_mmu_index(CPUState *env)
 }
 
 int riscv_cpu_hw_interrupts_pending(CPUState *env);
+void riscv_update_interrupt_mask(CPUState *env);
 
 #include "cpu-all.h"
 #include "exec-all.h"
@@ -217,6 +266,11 @@ static inline bool cpu_has_work(CPUState *env)
 
 }
 
+/* called when the halted CPU has no work */
+static inline void cpu_idle(CPUState *env)
+{
+}
+
 static inline int riscv_mstatus_fs(CPUState *env)
 {
     return env->mstatus & MSTATUS_FS;
@@ -228,6 +282,8 @@ void cpu_reset_nmi(CPUState *env, int number);
 
 void csr_write_helper(CPUState *env, target_ulong val_to_write, target_ulong csrno);
 
+target_ulong priv_version_csr_filter(CPUState *env, target_ulong csrno);
+
 void do_nmi(CPUState *env);
 
 static inline void cpu_pc_from_tb(CPUState *cs, TranslationBlock *tb)
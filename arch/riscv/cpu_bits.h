@@ -28,6 +28,8 @@
 #define FSR_AEXC                          (FSR_NVA | FSR_OFA | FSR_UFA | FSR_DZA | FSR_NXA)
 
 /* CSR numbers */
+#define CSR_TABLE_SIZE                    0x1000 /* CSR numbers are 12-bit */
+
 #define CSR_FFLAGS                        0x1
 #define CSR_FRM                           0x2
 #define CSR_FCSR                          0x3
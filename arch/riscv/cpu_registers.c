@@ -21,6 +21,20 @@
 #include "cpu.h"
 #include "cpu_registers.h"
 
+// priv, mstatus, mie and mideleg are inputs of `interrupt_enable_mask`, so it is refreshed after each write
+#define RISCV_REGISTER_SETTER(width)                                                         \
+    void tlib_set_register_value_##width(int reg_number, uint##width##_t value)              \
+    {                                                                                        \
+        uint##width##_t* ptr = get_reg_pointer_##width(reg_number);                          \
+        if(ptr == NULL)                                                                      \
+        {                                                                                    \
+            tlib_abortf("Write to undefined CPU register number %d detected", reg_number);   \
+        }                                                                                    \
+                                                                                             \
+        *ptr = value;                                                                        \
+        riscv_update_interrupt_mask(cpu);                                                    \
+    }                                                                                        \
+
 // REMARK: here we use #ifdef/#endif,#ifdef/#endif notation just to be consistent with header file; in header it is required by our parser
 #ifdef TARGET_RISCV64
 uint64_t *get_reg_pointer_64(int reg)
@@ -95,7 +109,8 @@ uint64_t *get_reg_pointer_64(int reg)
     return NULL;
 }
 
-CPU_REGISTER_ACCESSOR(64)
+CPU_REGISTER_GETTER(64)
+RISCV_REGISTER_SETTER(64)
 #endif
 #ifdef TARGET_RISCV32
 uint32_t *get_reg_pointer_32(int reg)
@@ -169,5 +184,6 @@ uint32_t *get_reg_pointer_32(int reg)
     return NULL;
 }
 
-CPU_REGISTER_ACCESSOR(32)
+CPU_REGISTER_GETTER(32)
+RISCV_REGISTER_SETTER(32)
 #endif
@@ -43,6 +43,8 @@ void cpu_reset(CPUState *env)
     custom_instruction_descriptor_t custom_instructions[CPU_CUSTOM_INSTRUCTIONS_LIMIT];
     memcpy(custom_instructions, env->custom_instructions,
            sizeof(custom_instruction_descriptor_t) * CPU_CUSTOM_INSTRUCTIONS_LIMIT);
+    custom_instruction_bucket_t custom_instruction_buckets[CUSTOM_INSTRUCTION_BUCKETS];
+    memcpy(custom_instruction_buckets, env->custom_instruction_buckets, sizeof(custom_instruction_buckets));
 
     memset(env, 0, offsetof(CPUState, breakpoints));
 
@@ -62,7 +64,9 @@ void cpu_reset(CPUState *env)
     env->custom_instructions_count = custom_instructions_count;
     memcpy(env->custom_instructions, custom_instructions,
            sizeof(custom_instruction_descriptor_t) * CPU_CUSTOM_INSTRUCTIONS_LIMIT);
+    memcpy(env->custom_instruction_buckets, custom_instruction_buckets, sizeof(custom_instruction_buckets));
     env->pmp_napot_grain = -1;
+    riscv_update_interrupt_mask(env);
 
     // TODO: vlen and elen should be alterable to match machine architectures
     env->vlen = 512;
@@ -101,24 +105,23 @@ int get_interrupts_in_order(target_ulong pending_interrupts, target_ulong priv)
 }
 
 /*
- * Return RISC-V IRQ number if an interrupt should be taken, else -1.
- * Used in cpu-exec.c
+ * Recompute the set of interrupts that may be taken in the current state.
+ * Must be called whenever priv, mstatus, mie, mideleg or sideleg changes.
  *
  * Adapted from Spike's processor_t::take_interrupt()
  */
-int riscv_cpu_hw_interrupts_pending(CPUState *env)
+void riscv_update_interrupt_mask(CPUState *env)
 {
-    target_ulong pending_interrupts = env->mip & env->mie;
+    target_ulong enabled_interrupts = env->mie;
     target_ulong priv = env->priv;
-    target_ulong enabled_interrupts = (target_ulong) - 1UL;
 
     switch (priv) {
     /* Disable interrupts for lower privileges, if interrupt is not delegated it is for higher level */
     case PRV_M:
-        pending_interrupts &= ~((IRQ_SS | IRQ_ST | IRQ_SE) & env->mideleg);                /* fall through */
+        enabled_interrupts &= ~((IRQ_SS | IRQ_ST | IRQ_SE) & env->mideleg);                /* fall through */
     case PRV_S:
         /* For future use, extension N not implemented yet */
-        pending_interrupts &= ~((IRQ_US | IRQ_UT | IRQ_UE) & env->mideleg & env->sideleg); /* fall through */
+        enabled_interrupts &= ~((IRQ_US | IRQ_UT | IRQ_UE) & env->mideleg & env->sideleg); /* fall through */
     case PRV_U:
         break;
     }
@@ -129,13 +132,22 @@ int riscv_cpu_hw_interrupts_pending(CPUState *env)
         enabled_interrupts &= ~(env->mideleg);
     }
 
-    enabled_interrupts &= pending_interrupts;
+    env->interrupt_enable_mask = enabled_interrupts;
+}
+
+/*
+ * Return RISC-V IRQ number if an interrupt should be taken, else -1.
+ * Used in cpu-exec.c
+ */
+int riscv_cpu_hw_interrupts_pending(CPUState *env)
+{
+    target_ulong enabled_interrupts = env->mip & env->interrupt_enable_mask;
 
     if (!enabled_interrupts) {
         return EXCP_NONE;
     }
 
-    return (env->privilege_architecture >= RISCV_PRIV1_11) ? get_interrupts_in_order(enabled_interrupts, priv) : ctz64(
+    return (env->privilege_architecture >= RISCV_PRIV1_11) ? get_interrupts_in_order(enabled_interrupts, env->priv) : ctz64(
         enabled_interrupts);
 }
 
@@ -502,6 +514,12 @@ void do_nmi(CPUState *env)
 
 void tlib_arch_dispose()
 {
+    int i;
+    for (i = 0; i < cpu->custom_instructions_count; i++) {
+        if (cpu->custom_instructions[i].ops != NULL) {
+            tlib_free(cpu->custom_instructions[i].ops);
+        }
+    }
 }
 
 int cpu_init(const char *cpu_model)
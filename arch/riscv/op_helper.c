@@ -239,6 +239,7 @@ inline void csr_write_helper(CPUState *env, target_ulong val_to_write, target_ul
         dirty |= (mstatus & MSTATUS_XS) == MSTATUS_XS;
         mstatus = set_field(mstatus, MSTATUS_SD, dirty);
         env->mstatus = mstatus;
+        riscv_update_interrupt_mask(env);
         break;
     }
     case CSR_MIP: {
@@ -254,10 +255,12 @@ inline void csr_write_helper(CPUState *env, target_ulong val_to_write, target_ul
     }
     case CSR_MIE: {
         env->mie = (env->mie & ~all_ints) | (val_to_write & all_ints);
+        riscv_update_interrupt_mask(env);
         break;
     }
     case CSR_MIDELEG:
         env->mideleg = (env->mideleg & ~delegable_ints) | (val_to_write & delegable_ints);
+        riscv_update_interrupt_mask(env);
         break;
     case CSR_MEDELEG: {
         target_ulong mask = 0;
@@ -316,6 +319,7 @@ inline void csr_write_helper(CPUState *env, target_ulong val_to_write, target_ul
         target_ulong s = env->mie;
         target_ulong mask = IRQ_US | IRQ_SS | IRQ_UT | IRQ_ST | IRQ_UE | IRQ_SE;
         env->mie = (s & ~mask) | ((val_to_write & deleg) & mask);
+        riscv_update_interrupt_mask(env);
         break;
     }
     case CSR_SATP: /* CSR_SPTBR */ {
@@ -755,6 +759,7 @@ void riscv_set_mode(CPUState *env, target_ulong newpriv)
     }
     helper_tlb_flush(env);
     env->priv = newpriv;
+    riscv_update_interrupt_mask(env);
 }
 
 target_ulong helper_sret(CPUState *env, target_ulong cpu_pc_deb)
@@ -557,21 +557,37 @@ static void gen_arith_imm(DisasContext *dc, uint32_t opc, int rd, int rs1, targe
     tcg_temp_free(source1);
 }
 
+/* ra and t0 are the link registers of the standard calling convention */
+static inline int is_link_register(int reg)
+{
+    return reg == 1 || reg == 5;
+}
+
 static void gen_jal(CPUState *env, DisasContext *dc, int rd, target_ulong imm)
 {
     target_ulong next_pc;
+    int misaligned = 0;
 
     /* check misaligned: */
     next_pc = dc->base.pc + imm;
     if (!riscv_has_ext(env, RISCV_FEATURE_RVC)) {
         if ((next_pc & 0x3) != 0) {
             generate_exception_mbadaddr(dc, RISCV_EXCP_INST_ADDR_MIS);
+            misaligned = 1;
         }
     }
     if (rd != 0) {
         tcg_gen_movi_tl(cpu_gpr[rd], dc->base.npc);
     }
+    if (is_link_register(rd)) {
+        gen_call_trace_calli(next_pc, dc->base.npc);
+    }
 
+    // plain jumps are translated through
+    if (rd == 0 && !misaligned && tb_superblock_continue(&dc->base, dc->base.npc, next_pc)) {
+        dc->base.npc = next_pc;
+        return;
+    }
     gen_goto_tb(dc, 0, dc->base.pc + imm); /* must use this for safety */
     dc->base.is_jmp = BS_BRANCH;
 
@@ -598,6 +614,11 @@ static void gen_jalr(CPUState *env, DisasContext *dc, uint32_t opc, int rd, int
         if (rd != 0) {
             tcg_gen_movi_tl(cpu_gpr[rd], dc->base.npc);
         }
+        if (is_link_register(rd)) {
+            gen_call_trace_call(cpu_pc, dc->base.npc);
+        } else if (rd == 0 && is_link_register(rs1)) {
+            gen_call_trace_return(cpu_pc);
+        }
         gen_exit_tb_no_chaining(dc->base.tb);
 
         gen_set_label(misaligned);
@@ -1371,6 +1392,146 @@ static void gen_fp_arith(DisasContext *dc, uint32_t opc, int rd, int rs1, int rs
     tcg_temp_free(write_int_rd);
 }
 
+/* CSR reads that can be translated inline, indexed by the CSR number;
+   all other CSRs are read through `helper_csrrs` */
+typedef enum {
+    CSR_READ_HELPER = 0,
+    CSR_READ_FIELD,      /* plain target_ulong CPUState field */
+    CSR_READ_ZERO,
+    CSR_READ_INSTRET,
+    CSR_READ_CYCLE,
+#if defined(TARGET_RISCV32)
+    CSR_READ_INSTRETH,
+    CSR_READ_CYCLEH,
+#endif
+} csr_read_kind_t;
+
+typedef struct csr_read_descriptor_t {
+    uint32_t kind;
+    uint32_t offset;
+} csr_read_descriptor_t;
+
+#define CSR_READ_FROM(field) { CSR_READ_FIELD, offsetof(CPUState, field) }
+
+static const csr_read_descriptor_t csr_read_table[CSR_TABLE_SIZE] = {
+    [CSR_SSCRATCH]   = CSR_READ_FROM(sscratch),
+    [CSR_SEPC]       = CSR_READ_FROM(sepc),
+    [CSR_SCAUSE]     = CSR_READ_FROM(scause),
+    [CSR_STVAL]      = CSR_READ_FROM(stval),
+    [CSR_STVEC]      = CSR_READ_FROM(stvec),
+    [CSR_SCOUNTEREN] = CSR_READ_FROM(scounteren),
+    [CSR_MSTATUS]    = CSR_READ_FROM(mstatus),
+    [CSR_MIE]        = CSR_READ_FROM(mie),
+    [CSR_MSCRATCH]   = CSR_READ_FROM(mscratch),
+    [CSR_MEPC]       = CSR_READ_FROM(mepc),
+    [CSR_MCAUSE]     = CSR_READ_FROM(mcause),
+    [CSR_MTVAL]      = CSR_READ_FROM(mtval),
+    [CSR_MTVEC]      = CSR_READ_FROM(mtvec),
+    [CSR_MCOUNTEREN] = CSR_READ_FROM(mcounteren),
+    [CSR_MEDELEG]    = CSR_READ_FROM(medeleg),
+    [CSR_MIDELEG]    = CSR_READ_FROM(mideleg),
+    [CSR_MHARTID]    = CSR_READ_FROM(mhartid),
+    [CSR_MARCHID]    = { CSR_READ_ZERO },
+    [CSR_MIMPID]     = { CSR_READ_ZERO },
+    [CSR_MVENDORID]  = { CSR_READ_ZERO },
+    [CSR_INSTRET]    = { CSR_READ_INSTRET },
+    [CSR_MINSTRET]   = { CSR_READ_INSTRET },
+    [CSR_CYCLE]      = { CSR_READ_CYCLE },
+    [CSR_MCYCLE]     = { CSR_READ_CYCLE },
+#if defined(TARGET_RISCV32)
+    /* CSR_INSTRETH is not handled by `csr_read_helper` and raises an illegal instruction exception */
+    [CSR_MINSTRETH]  = { CSR_READ_INSTRETH },
+    [CSR_CYCLEH]     = { CSR_READ_CYCLEH },
+    [CSR_MCYCLEH]    = { CSR_READ_CYCLEH },
+#endif
+};
+
+/* value = (instructions_count_total_value - snapshot + snapshot_offset) [* cycles_per_instruction] */
+static void gen_counter_read(TCGv dest, size_t snapshot, size_t snapshot_offset, int scale, int high)
+{
+    TCGv_i64 value = tcg_temp_new_i64();
+    TCGv_i64 t = tcg_temp_new_i64();
+
+    tcg_gen_ld_i64(value, cpu_env, offsetof(CPUState, instructions_count_total_value));
+    tcg_gen_ld_i64(t, cpu_env, snapshot);
+    tcg_gen_sub_i64(value, value, t);
+    tcg_gen_ld_i64(t, cpu_env, snapshot_offset);
+    tcg_gen_add_i64(value, value, t);
+    if (scale) {
+        tcg_gen_ld32u_i64(t, cpu_env, offsetof(CPUState, cycles_per_instruction));
+        tcg_gen_mul_i64(value, value, t);
+    }
+    if (high) {
+        tcg_gen_shri_i64(value, value, 32);
+    }
+    tcg_gen_trunc_i64_tl(dest, value);
+
+    tcg_temp_free_i64(t);
+    tcg_temp_free_i64(value);
+}
+
+/* translates a read-only access (csrrs/csrrc with x0) without calling the CSR helper;
+   returns 0 if the CSR has to be read through the helper */
+static int gen_csr_read_inline(DisasContext *dc, int rd, int csr)
+{
+    const csr_read_descriptor_t *desc = &csr_read_table[csr];
+
+    if (desc->kind == CSR_READ_HELPER) {
+        return 0;
+    }
+    // nonstandard CSRs may override the standard ones and CSR numbers may be remapped
+    // depending on the privilege architecture; the translation cache is flushed when
+    // either changes, see `tlib_nonstandard_csr_changed` and `tlib_set_privilege_architecture`
+    if (tlib_has_nonstandard_csr(csr) || priv_version_csr_filter(cpu, csr) != csr) {
+        return 0;
+    }
+
+    /* privilege level check of `validate_csr`; the validation level is fixed per translation */
+    unsigned csr_priv = get_field(csr, 0x300);
+    if (cpu->csr_validation_level != CSR_VALIDATION_NONE && csr_priv != PRV_U) {
+        int priv_ok = gen_new_label();
+        TCGv priv = tcg_temp_new();
+        tcg_gen_ld_tl(priv, cpu_env, offsetof(CPUState, priv));
+        tcg_gen_brcondi_tl(TCG_COND_GEU, priv, csr_priv, priv_ok);
+        tcg_temp_free(priv);
+        generate_exception(dc, RISCV_EXCP_ILLEGAL_INST);
+        gen_set_label(priv_ok);
+    }
+
+    TCGv dest = tcg_temp_new();
+    switch (desc->kind) {
+    case CSR_READ_FIELD:
+        tcg_gen_ld_tl(dest, cpu_env, desc->offset);
+        break;
+    case CSR_READ_ZERO:
+        tcg_gen_movi_tl(dest, 0);
+        break;
+    case CSR_READ_INSTRET:
+        gen_counter_read(dest, offsetof(CPUState, minstret_snapshot), offsetof(CPUState, minstret_snapshot_offset), 0, 0);
+        break;
+    case CSR_READ_CYCLE:
+        gen_counter_read(dest, offsetof(CPUState, mcycle_snapshot), offsetof(CPUState, mcycle_snapshot_offset), 1, 0);
+        break;
+#if defined(TARGET_RISCV32)
+    case CSR_READ_INSTRETH:
+        gen_counter_read(dest, offsetof(CPUState, minstret_snapshot), offsetof(CPUState, minstret_snapshot_offset), 0, 1);
+        break;
+    case CSR_READ_CYCLEH:
+        gen_counter_read(dest, offsetof(CPUState, mcycle_snapshot), offsetof(CPUState, mcycle_snapshot_offset), 1, 1);
+        break;
+#endif
+    }
+    gen_set_gpr(rd, dest);
+    tcg_temp_free(dest);
+
+    if (desc->kind != CSR_READ_FIELD && desc->kind != CSR_READ_ZERO) {
+        /* the instructions count is updated for the whole block when it starts,
+           so end the block here (chaining to the next one) for the counters to be exact */
+        dc->base.is_jmp = BS_STOP;
+    }
+    return 1;
+}
+
 static void gen_system(DisasContext *dc, uint32_t opc, int rd, int rs1, int csr)
 {
     TCGv source1, csr_store, dest, rs1_pass, imm_rs1;
@@ -1436,6 +1597,10 @@ static void gen_system(DisasContext *dc, uint32_t opc, int rd, int rs1, int csr)
         }
         break;
     default:
+        if (rs1 == 0 && (opc == OPC_RISC_CSRRS || opc == OPC_RISC_CSRRC || opc == OPC_RISC_CSRRSI || opc == OPC_RISC_CSRRCI) &&
+            gen_csr_read_inline(dc, rd, csr)) {
+            break;
+        }
         tcg_gen_movi_tl(imm_rs1, rs1);
         switch (opc) {
         case OPC_RISC_CSRRW:
@@ -1897,42 +2062,149 @@ static void decode_RV32_64G(CPUState *env, DisasContext *dc)
     }
 }
 
+static custom_instruction_descriptor_t *find_custom_instruction(CPUState *env, uint64_t opcode)
+{
+    if (env->custom_instructions_count == 0) {
+        return NULL;
+    }
+
+    // only descriptors registered in the bucket of this major opcode can match;
+    // they are visited in the installation order, so the first installed one wins
+    uint64_t *bucket = env->custom_instruction_buckets[opcode & CUSTOM_INSTRUCTION_BUCKET_MASK];
+    int word;
+    for (word = 0; word < CUSTOM_INSTRUCTION_BUCKET_WORDS; word++) {
+        uint64_t candidates = bucket[word];
+        while (candidates) {
+            int index = word * 64 + ctz64(candidates);
+            custom_instruction_descriptor_t *ci = &env->custom_instructions[index];
+            if ((opcode & ci->mask) == ci->pattern) {
+                return ci;
+            }
+            candidates &= candidates - 1;
+        }
+    }
+    return NULL;
+}
+
+static void gen_custom_instruction_ops(DisasContext *dc, custom_instruction_descriptor_t *ci)
+{
+    TCGv t[CUSTOM_INSTRUCTION_TEMPS];
+    uint32_t i;
+
+    for (i = 0; i < CUSTOM_INSTRUCTION_TEMPS; i++) {
+        t[i] = tcg_temp_new();
+        tcg_gen_movi_tl(t[i], 0);
+    }
+
+    for (i = 0; i < ci->ops_count; i++) {
+        uint64_t *op = &ci->ops[i * CUSTOM_INSTRUCTION_OP_WORDS];
+        uint64_t dst = op[1], src1 = op[2], src2 = op[3];
+
+        switch (op[0]) {
+        case CI_OP_MOVI:
+            tcg_gen_movi_tl(t[dst], src1);
+            break;
+        case CI_OP_EXTRACT:
+            // the instruction is known at translation time, so are its fields
+            tcg_gen_movi_tl(t[dst], (dc->opcode >> src1) & (~0ULL >> (64 - src2)));
+            break;
+        case CI_OP_SEXTRACT:
+            tcg_gen_movi_tl(t[dst], (int64_t)(dc->opcode << (64 - src1 - src2)) >> (64 - src2));
+            break;
+        case CI_OP_READ_GPR:
+            gen_get_gpr(t[dst], (dc->opcode >> src1) & 0x1f);
+            break;
+        case CI_OP_WRITE_GPR:
+            gen_set_gpr((dc->opcode >> dst) & 0x1f, t[src1]);
+            break;
+        case CI_OP_ADD:
+            tcg_gen_add_tl(t[dst], t[src1], t[src2]);
+            break;
+        case CI_OP_SUB:
+            tcg_gen_sub_tl(t[dst], t[src1], t[src2]);
+            break;
+        case CI_OP_AND:
+            tcg_gen_and_tl(t[dst], t[src1], t[src2]);
+            break;
+        case CI_OP_OR:
+            tcg_gen_or_tl(t[dst], t[src1], t[src2]);
+            break;
+        case CI_OP_XOR:
+            tcg_gen_xor_tl(t[dst], t[src1], t[src2]);
+            break;
+        case CI_OP_SHL:
+        case CI_OP_SHR:
+        case CI_OP_SAR: {
+            TCGv shamt = tcg_temp_new();
+            tcg_gen_andi_tl(shamt, t[src2], TARGET_LONG_BITS - 1);
+            if (op[0] == CI_OP_SHL) {
+                tcg_gen_shl_tl(t[dst], t[src1], shamt);
+            } else if (op[0] == CI_OP_SHR) {
+                tcg_gen_shr_tl(t[dst], t[src1], shamt);
+            } else {
+                tcg_gen_sar_tl(t[dst], t[src1], shamt);
+            }
+            tcg_temp_free(shamt);
+            break;
+        }
+        case CI_OP_MUL:
+            tcg_gen_mul_tl(t[dst], t[src1], t[src2]);
+            break;
+        case CI_OP_SLT:
+            tcg_gen_setcond_tl(TCG_COND_LT, t[dst], t[src1], t[src2]);
+            break;
+        case CI_OP_SLTU:
+            tcg_gen_setcond_tl(TCG_COND_LTU, t[dst], t[src1], t[src2]);
+            break;
+        default:
+            // ops are validated when the instruction is installed
+            tlib_abortf("Unexpected custom instruction op: %d", (int)op[0]);
+            break;
+        }
+    }
+
+    for (i = 0; i < CUSTOM_INSTRUCTION_TEMPS; i++) {
+        tcg_temp_free(t[i]);
+    }
+}
+
 static int disas_insn(CPUState *env, DisasContext *dc)
 {
     dc->opcode = ldq_code(dc->base.pc);
     /* handle custom instructions */
-    int i;
-    for (i = 0; i < env->custom_instructions_count; i++) {
-        custom_instruction_descriptor_t *ci = &env->custom_instructions[i];
-
-        if ((dc->opcode & ci->mask) == ci->pattern) {
-            dc->base.npc = dc->base.pc + ci->length;
+    custom_instruction_descriptor_t *ci = find_custom_instruction(env, dc->opcode);
+    if (ci != NULL && ci->ops != NULL) {
+        gen_custom_instruction_ops(dc, ci);
+        dc->base.pc += ci->length;
+        return ci->length;
+    }
+    if (ci != NULL) {
+        dc->base.npc = dc->base.pc + ci->length;
 
-            TCGv_i64 id = tcg_const_i64(ci->id);
-            TCGv_i64 opcode = tcg_const_i64(dc->opcode & ((1ULL << (8 * ci->length)) - 1));
-            TCGv_i32 pc_modified = tcg_temp_new_i32();
+        TCGv_i64 id = tcg_const_i64(ci->id);
+        TCGv_i64 opcode = tcg_const_i64(dc->opcode & ((1ULL << (8 * ci->length)) - 1));
+        TCGv_i32 pc_modified = tcg_temp_new_i32();
 
-            gen_sync_pc(dc);
-            gen_helper_handle_custom_instruction(pc_modified, id, opcode);
+        gen_sync_pc(dc);
+        gen_helper_handle_custom_instruction(pc_modified, id, opcode);
 
-            int exit_tb_label = gen_new_label();
-            tcg_gen_brcondi_i64(TCG_COND_EQ, pc_modified, 1, exit_tb_label);
+        int exit_tb_label = gen_new_label();
+        tcg_gen_brcondi_i64(TCG_COND_EQ, pc_modified, 1, exit_tb_label);
 
-            // this is executed conditionally - only if `handle_custom_instruction` returns 0
-            // otherwise `cpu_pc` points to a proper value and should not be overwritten by `dc->base.pc`
-            dc->base.pc = dc->base.npc;
-            gen_sync_pc(dc);
+        // this is executed conditionally - only if `handle_custom_instruction` returns 0
+        // otherwise `cpu_pc` points to a proper value and should not be overwritten by `dc->base.pc`
+        dc->base.pc = dc->base.npc;
+        gen_sync_pc(dc);
 
-            gen_set_label(exit_tb_label);
-            gen_exit_tb_no_chaining(dc->base.tb);
-            dc->base.is_jmp = BS_BRANCH;
+        gen_set_label(exit_tb_label);
+        gen_exit_tb_no_chaining(dc->base.tb);
+        dc->base.is_jmp = BS_BRANCH;
 
-            tcg_temp_free_i64(id);
-            tcg_temp_free_i64(opcode);
-            tcg_temp_free_i64(pc_modified);
+        tcg_temp_free_i64(id);
+        tcg_temp_free_i64(opcode);
+        tcg_temp_free_i64(pc_modified);
 
-            return ci->length;
-        }
+        return ci->length;
     }
 
     int is_compressed = (extract32(dc->opcode, 0, 2) != 3);
@@ -1969,6 +2241,11 @@ int gen_breakpoint(DisasContextBase *base, CPUBreakpoint *bp)
     return 1;
 }
 
+void gen_sync_guest_pc(DisasContextBase *base)
+{
+    gen_sync_pc((DisasContext *)base);
+}
+
 int gen_intermediate_code(CPUState *env, DisasContextBase *base)
 {
     base->tb->size += disas_insn(env, (DisasContext *)base);
@@ -2043,12 +2320,14 @@ int process_interrupt(int interrupt_request, CPUState *env)
     return 0;
 }
 
-//TODO: These empty implementations are required due to problems with weak attribute.
-//Remove this after #7035.
-void cpu_exec_epilogue(CPUState *env)
+void cpu_exec_prologue(CPUState *env)
 {
+    // register writes go through tlib_set_register_value, but the host may also restore the whole CPU state
+    riscv_update_interrupt_mask(env);
 }
 
-void cpu_exec_prologue(CPUState *env)
+//TODO: This empty implementation is required due to problems with weak attribute.
+//Remove this after #7035.
+void cpu_exec_epilogue(CPUState *env)
 {
 }
@@ -390,6 +390,11 @@ static inline bool cpu_has_work(CPUState *env)
     return (env->interrupt_request & CPU_INTERRUPT_HARD) && cpu_interrupts_enabled(env);
 }
 
+/* called when the halted CPU has no work */
+static inline void cpu_idle(CPUState *env)
+{
+}
+
 #include "exec-all.h"
 
 static inline void cpu_pc_from_tb(CPUState *env, TranslationBlock *tb)
@@ -2785,6 +2785,11 @@ int gen_breakpoint(DisasContextBase *base, CPUBreakpoint *bp)
     return 1;
 }
 
+void gen_sync_guest_pc(DisasContextBase *base)
+{
+    save_state((DisasContext *)base, cpu_cond);
+}
+
 int gen_intermediate_code(CPUState *env, DisasContextBase *base)
 {
     if (base->tb->search_pc) {
@@ -25,6 +25,7 @@
 #include "cpu.h"
 #include "tcg-op.h"
 #include "debug.h"
+#include "call_trace.h"
 
 #include <global_helper.h>
 #define GEN_HELPER 1
@@ -131,6 +132,34 @@ void gen_exit_tb_no_chaining(TranslationBlock *tb)
     gen_exit_tb_inner(0, tb, tb->icount);
 }
 
+void gen_call_trace_call(TCGv target, target_ulong return_address)
+{
+    if (cpu->call_trace == NULL) {
+        return;
+    }
+    TCGv ret = tcg_const_tl(return_address);
+    gen_helper_call_trace_call(target, ret);
+    tcg_temp_free(ret);
+}
+
+void gen_call_trace_calli(target_ulong target, target_ulong return_address)
+{
+    if (cpu->call_trace == NULL) {
+        return;
+    }
+    TCGv dest = tcg_const_tl(target);
+    gen_call_trace_call(dest, return_address);
+    tcg_temp_free(dest);
+}
+
+void gen_call_trace_return(TCGv target)
+{
+    if (cpu->call_trace == NULL) {
+        return;
+    }
+    gen_helper_call_trace_return(target);
+}
+
 static inline void gen_block_footer(TranslationBlock *tb)
 {
     if (tlib_is_on_block_translation_enabled) {
@@ -158,7 +187,60 @@ static inline void gen_block_footer(TranslationBlock *tb)
 
 static inline uint64_t get_max_instruction_count(CPUState *env, TranslationBlock *tb)
 {
-    return maximum_block_size > env->instructions_count_threshold ? env->instructions_count_threshold : maximum_block_size;
+    if (tb->cflags & CF_COUNT_MASK) {
+        return tb->cflags & CF_COUNT_MASK;
+    }
+    if (tb->cflags & CF_DEFERRED) {
+        // deferred blocks are not translated on behalf of the current execution quantum
+        return maximum_block_size;
+    }
+    uint64_t max_count = maximum_block_size > env->instructions_count_threshold ? env->instructions_count_threshold : maximum_block_size;
+    if ((tb->cflags & CF_TIER1) && max_count > TB_TIER1_MAX_INSNS) {
+        // most first tier blocks will never be retranslated, don't waste time on a code that might never be reached
+        max_count = TB_TIER1_MAX_INSNS;
+    }
+    return max_count;
+}
+
+// Decided once per block in tb_gen_code and recorded in its cflags.
+int tb_superblocks_allowed(CPUState *env)
+{
+    if (env->superblocks_disabled || env->block_begin_hook_present || env->block_finished_hook_present) {
+        // the hooks report block boundaries to the host
+        return 0;
+    }
+    if (env->call_trace != NULL) {
+        // the tracer expects jumps to end blocks to get exact timestamps
+        return 0;
+    }
+    return 1;
+}
+
+// Called by the frontends on unconditional direct jumps. Returns nonzero if the
+// translation should continue at the target instead of ending the block; the
+// frontend then only moves its pc there. Only forward jumps within the pages
+// the block already occupies are followed, so that extending the block size
+// over the skipped bytes keeps the page tracking and the SMC invalidation exact.
+int tb_superblock_continue(DisasContextBase *dc, target_ulong next_pc, target_ulong target)
+{
+    TranslationBlock *tb = dc->tb;
+
+    if (!(tb->cflags & CF_SUPERBLOCKS)) {
+        return 0;
+    }
+    if (target < next_pc) {
+        return 0;
+    }
+    if ((target & TARGET_PAGE_MASK) != (tb->pc & TARGET_PAGE_MASK) &&
+        (target & TARGET_PAGE_MASK) != ((next_pc - 1) & TARGET_PAGE_MASK)) {
+        return 0;
+    }
+    if (target - tb->pc >= TARGET_PAGE_SIZE) {
+        // keep the block size within its documented bound
+        return 0;
+    }
+    dc->superblock_jump = 1;
+    return 1;
 }
 
 static void cpu_gen_code_inner(CPUState *env, TranslationBlock *tb, int search_pc)
@@ -173,6 +255,7 @@ static void cpu_gen_code_inner(CPUState *env, TranslationBlock *tb, int search_p
     tb->search_pc = search_pc;
     dc->tb = tb;
     dc->is_jmp = 0;
+    dc->superblock_jump = 0;
     dc->pc = tb->pc;
 
     gen_block_header(tb);
@@ -187,12 +270,23 @@ static void cpu_gen_code_inner(CPUState *env, TranslationBlock *tb, int search_p
                 break;
             }
         }
+        if ((tb->cflags & CF_DEFERRED) && !tb->search_pc && tb->icount > 0 && !tb_code_fetch_is_cached(env, dc->pc)) {
+            // fetching the next instruction could fault, which is not allowed outside of the execution loop
+            break;
+        }
         tb->prev_size = tb->size;
 
         if (tb->search_pc) {
             tcg->gen_opc_pc[gen_opc_ptr - tcg->gen_opc_buf] = dc->pc;
             tcg->gen_opc_instr_start[gen_opc_ptr - tcg->gen_opc_buf] = 1;
         }
+        if (unlikely(env->pc_hooks_count != 0) && pc_has_hooks(env, dc->pc)) {
+            // only the blocks containing a hooked pc pay for the helper call
+            TCGv hook_pc = tcg_const_tl(dc->pc);
+            gen_sync_guest_pc(dc);
+            gen_helper_pc_hook_event(hook_pc);
+            tcg_temp_free(hook_pc);
+        }
         int do_break = 0;
         tb->icount++;
         if (!gen_intermediate_code(env, dc)) {
@@ -201,6 +295,11 @@ static void cpu_gen_code_inner(CPUState *env, TranslationBlock *tb, int search_p
         if (tcg_check_temp_count()) {
             tlib_abortf("TCG temps leak detected at PC %08X", dc->pc);
         }
+        if (dc->superblock_jump) {
+            // the block covers the bytes skipped by the jump too
+            tb->size = dc->pc - tb->pc;
+            dc->superblock_jump = 0;
+        }
         if (!tb->search_pc) {
             // it looks like `search_pc` is set to 1 only when restoring the state;
             // the intention here is to set `original_size` value only during the first block generation
@@ -230,6 +329,31 @@ static void cpu_gen_code_inner(CPUState *env, TranslationBlock *tb, int search_p
     gen_block_footer(tb);
 }
 
+// TLB misses are handled by the softmmu helpers; only blocks translated with
+// memory access hooks enabled call the variants that report the accesses.
+static inline void set_memory_access_helpers(TranslationBlock *tb)
+{
+    if (tb->flags & TB_FLAG_MEMORY_HOOKS) {
+        tcg->ldb = __ldb_mmu;
+        tcg->ldw = __ldw_mmu;
+        tcg->ldl = __ldl_mmu;
+        tcg->ldq = __ldq_mmu;
+        tcg->stb = __stb_mmu;
+        tcg->stw = __stw_mmu;
+        tcg->stl = __stl_mmu;
+        tcg->stq = __stq_mmu;
+    } else {
+        tcg->ldb = __ldb_mmu_nohook;
+        tcg->ldw = __ldw_mmu_nohook;
+        tcg->ldl = __ldl_mmu_nohook;
+        tcg->ldq = __ldq_mmu_nohook;
+        tcg->stb = __stb_mmu_nohook;
+        tcg->stw = __stw_mmu_nohook;
+        tcg->stl = __stl_mmu_nohook;
+        tcg->stq = __stq_mmu_nohook;
+    }
+}
+
 /* '*gen_code_size_ptr' contains the size of the generated code (host
    code).
  */
@@ -241,6 +365,8 @@ void cpu_gen_code(CPUState *env, TranslationBlock *tb, int *gen_code_size_ptr)
 
     tcg_func_start(s);
     cpu_gen_code_inner(env, tb, 0);
+    s->optimizations_disabled = !!(tb->cflags & (CF_TIER1 | CF_PROVISIONAL));
+    set_memory_access_helpers(tb);
 
     /* generate machine code */
     gen_code_buf = tb->tc_ptr;
@@ -266,6 +392,9 @@ int cpu_restore_state(CPUState *env, TranslationBlock *tb, uintptr_t searched_pc
 
     tcg_func_start(s);
     cpu_gen_code_inner(env, tb, 1);
+    // the code has to be regenerated exactly the same way as in `cpu_gen_code`
+    s->optimizations_disabled = !!(tb->cflags & (CF_TIER1 | CF_PROVISIONAL));
+    set_memory_access_helpers(tb);
 
     /* find opc index corresponding to search_pc */
     tc_ptr = (uintptr_t)tb->tc_ptr;
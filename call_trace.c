@@ -0,0 +1,142 @@
+/*
+ *  Guest function call tracing.
+ *
+ *  Copyright (c) Antmicro
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "cpu.h"
+#include "call_trace.h"
+
+// Calls and returns always end the translation block, so the instructions
+// count updated in the block header is exact at the time of the event.
+static inline uint64_t call_trace_timestamp(CPUState *env)
+{
+    return env->instructions_count_total_value;
+}
+
+static void call_trace_record(CallTrace *trace, uint32_t type, CallTraceFrame *frame, uint32_t depth, uint64_t now)
+{
+    CallTraceEvent *event;
+
+    if (trace->count == trace->capacity) {
+        // the host did not drain the events in time; keep the older ones
+        trace->dropped_events++;
+        return;
+    }
+    event = &trace->events[(trace->head + trace->count) % trace->capacity];
+    event->function = frame->function;
+    event->return_address = frame->return_address;
+    event->timestamp = now;
+    event->duration = type == CALL_TRACE_EXIT ? now - frame->timestamp : 0;
+    event->type = type;
+    event->depth = depth;
+    trace->count++;
+}
+
+void call_trace_enable(CPUState *env, uint32_t capacity)
+{
+    CallTrace *trace = env->call_trace;
+
+    if (trace == NULL) {
+        trace = tlib_malloc(sizeof(CallTrace));
+        memset(trace, 0, sizeof(CallTrace));
+    } else if (trace->capacity != capacity) {
+        tlib_free(trace->events);
+        trace->events = NULL;
+    } else {
+        return;
+    }
+    trace->events = tlib_malloc(capacity * sizeof(CallTraceEvent));
+    trace->capacity = capacity;
+    trace->head = 0;
+    trace->count = 0;
+    env->call_trace = trace;
+}
+
+void call_trace_disable(CPUState *env)
+{
+    if (env->call_trace == NULL) {
+        return;
+    }
+    tlib_free(env->call_trace->events);
+    tlib_free(env->call_trace);
+    env->call_trace = NULL;
+}
+
+void call_trace_push(CPUState *env, target_ulong function, target_ulong return_address)
+{
+    CallTrace *trace = env->call_trace;
+    CallTraceFrame *frame;
+
+    if (trace == NULL) {
+        return;
+    }
+    frame = &trace->stack[trace->depth % CALL_TRACE_STACK_SIZE];
+    frame->function = function;
+    frame->return_address = return_address;
+    frame->timestamp = call_trace_timestamp(env);
+    call_trace_record(trace, CALL_TRACE_ENTRY, frame, trace->depth, frame->timestamp);
+    trace->depth++;
+}
+
+// Returns are matched against the return addresses on the shadow stack, so the
+// frames skipped by tail calls or longjmps are closed too, while jumps the
+// translator only suspected to be returns are ignored.
+void call_trace_pop(CPUState *env, target_ulong target)
+{
+    CallTrace *trace = env->call_trace;
+    uint32_t bottom, depth;
+    uint64_t now;
+
+    if (trace == NULL || trace->depth == 0) {
+        return;
+    }
+    bottom = trace->depth > CALL_TRACE_STACK_SIZE ? trace->depth - CALL_TRACE_STACK_SIZE : 0;
+    for (depth = trace->depth; depth > bottom; depth--) {
+        if (trace->stack[(depth - 1) % CALL_TRACE_STACK_SIZE].return_address == target) {
+            break;
+        }
+    }
+    if (depth == bottom) {
+        return;
+    }
+    now = call_trace_timestamp(env);
+    while (trace->depth >= depth) {
+        trace->depth--;
+        call_trace_record(trace, CALL_TRACE_EXIT, &trace->stack[trace->depth % CALL_TRACE_STACK_SIZE], trace->depth, now);
+    }
+}
+
+uint32_t call_trace_drain(CPUState *env, CallTraceEvent *buffer, uint32_t max_events)
+{
+    CallTrace *trace = env->call_trace;
+    uint32_t count, chunk;
+
+    if (trace == NULL) {
+        return 0;
+    }
+    count = trace->count < max_events ? trace->count : max_events;
+    // copy in at most two chunks, the events can wrap around the end of the ring
+    chunk = trace->capacity - trace->head;
+    if (chunk > count) {
+        chunk = count;
+    }
+    memcpy(buffer, &trace->events[trace->head], chunk * sizeof(CallTraceEvent));
+    memcpy(buffer + chunk, trace->events, (count - chunk) * sizeof(CallTraceEvent));
+    trace->head = (trace->head + count) % trace->capacity;
+    trace->count -= count;
+    return count;
+}
@@ -49,6 +49,8 @@ DEFAULT_INT_HANDLER2(uint32_t tlib_on_block_begin, uint64_t address, uint32_t si
 
 DEFAULT_VOID_HANDLER2(void tlib_on_block_finished, uint64_t pc, uint32_t executed_instructions)
 
+DEFAULT_INT_HANDLER2(uint32_t tlib_on_pc_hook, uint64_t pc, uint32_t callback_id)
+
 void *tlib_malloc(size_t size) __attribute__((weak));
 
 void *tlib_malloc(size_t size)
@@ -104,7 +104,7 @@ target_ulong virt_to_phys(target_ulong virtual, uint32_t access_type, uint32_t n
         physical = (physical + virtual) & TARGET_PAGE_MASK;
     } else {
         p = (void *)(uintptr_t)masked_virtual + env->tlb_table[found_idx][page_index].addend;
-        physical = tlib_host_ptr_to_guest_offset(p);
+        physical = ram_addr_from_host(p);
         if (physical == -1) {
             tlib_printf(LOG_LEVEL_ERROR, "No host mapping for host ptr %p", p);
             return -1;
@@ -116,7 +116,7 @@ target_ulong virt_to_phys(target_ulong virtual, uint32_t access_type, uint32_t n
 
 int tb_invalidated_flag;
 
-static void TLIB_NORETURN cpu_loop_exit_without_hook(CPUState *env)
+void TLIB_NORETURN cpu_loop_exit_without_hook(CPUState *env)
 {
     env->current_tb = NULL;
     longjmp(env->jmp_env, 1);
@@ -193,7 +193,18 @@ static TranslationBlock *tb_find_slow(CPUState *env, target_ulong pc, target_ulo
     }
 not_found:
     /* if no translated code available, then translate it now */
-    tb = tb_gen_code(env, pc, cs_base, flags, 0);
+    tb = NULL;
+    if (env->deferred_translation_enabled && !env->tb_cache_disabled) {
+        /* execute a placeholder now and translate the whole block later */
+        tb = tb_gen_provisional_code(env, pc, cs_base, flags);
+    }
+    if (tb == NULL) {
+        if (env->tb_tier2_threshold && !tb_promotion_take(env, pc)) {
+            tb = tb_gen_code(env, pc, cs_base, flags, CF_TIER1);
+        } else {
+            tb = tb_gen_code(env, pc, cs_base, flags, 0);
+        }
+    }
 
 found:
     /* Move the last found TB to the head of the list */
@@ -212,12 +223,12 @@ static inline TranslationBlock *tb_find_fast(CPUState *env)
 {
     TranslationBlock *tb;
     target_ulong cs_base, pc;
-    int flags;
+    uint64_t flags;
 
     /* we record a subset of the CPU state. It will
        always be the same before a given translated block
        is executed. */
-    cpu_get_tb_cpu_state(env, &pc, &cs_base, &flags);
+    tb_get_cpu_state(env, &pc, &cs_base, &flags);
     tb = env->tb_jmp_cache[tb_jmp_cache_hash_func(pc)];
     if (unlikely(!tb || tb->pc != pc || tb->cs_base != cs_base || tb->flags != flags || env->tb_cache_disabled)) {
         tb = tb_find_slow(env, pc, cs_base, flags);
@@ -264,6 +275,9 @@ int cpu_exec(CPUState *env)
     uintptr_t next_tb;
 
     if (env->wfi) {
+        if (!cpu_has_work(env)) {
+            cpu_idle(env);
+        }
         if (!cpu_has_work(env)) {
             return EXCP_WFI;
         }
@@ -336,13 +350,9 @@ int cpu_exec(CPUState *env)
                 if (unlikely(env->exception_index != -1)) {
                     cpu_loop_exit_without_hook(env);
                 }
-
-#ifdef TARGET_PROTO_ARM_M
-                if (env->regs[15] >= 0xffffffe0) {
-                    do_v7m_exception_exit(env);
-                    next_tb = 0;
+                if (unlikely(env->pc_hooks_pending)) {
+                    cpu_pc_hooks_apply_pending(env);
                 }
-#endif
 
                 tb = tb_find_fast(env);
                 /* Note: we do it here to avoid a gcc bug on Mac OS X when
@@ -394,6 +404,9 @@ int cpu_exec(CPUState *env)
         }
     } /* for(;;) */
 
+    if (unlikely(env->pc_hooks_pending)) {
+        cpu_pc_hooks_apply_pending(env);
+    }
     cpu_exec_epilogue(env);
 
     return ret;
@@ -23,6 +23,8 @@
 #else
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #endif
 #include "cpu.h"
@@ -113,6 +115,22 @@ CPUWriteMemoryFunc *io_mem_write[IO_MEM_NB_ENTRIES][4];
 CPUReadMemoryFunc *io_mem_read[IO_MEM_NB_ENTRIES][4];
 void *io_mem_opaque[IO_MEM_NB_ENTRIES];
 
+/* deferred translation support */
+#define DEFERRED_TRANSLATION_QUEUE_SIZE   256
+#define DEFERRED_TRANSLATION_MAX_ATTEMPTS 16
+
+typedef struct DeferredTranslation {
+    target_ulong pc;
+    target_ulong cs_base;
+    uint64_t flags;
+    int attempts;
+    TranslationBlock *provisional_tb;
+    uint32_t provisional_generation; /* the TB slot is stale once it differs */
+} DeferredTranslation;
+
+static DeferredTranslation deferred_translations[DEFERRED_TRANSLATION_QUEUE_SIZE];
+static int nb_deferred_translations;
+
 /* statistics */
 static int tlb_flush_count;
 static int tb_flush_count;
@@ -332,6 +350,54 @@ static void tlb_unprotect_code_phys(CPUState *env, ram_addr_t ram_addr, target_u
 
 #define DEFAULT_CODE_GEN_BUFFER_SIZE (32 * 1024 * 1024)
 
+#ifndef _WIN32
+/* size of the huge pages we try to back the large mappings with */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static inline uintptr_t huge_page_align(uintptr_t size)
+{
+    return (size + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+}
+
+/* Maps SIZE (a multiple of HUGE_PAGE_SIZE) bytes of anonymous memory backed
+   by explicit huge pages if the host reserved any, by transparent huge pages
+   otherwise, falling back to normal pages when neither is available.  */
+static void *mmap_huge(void *start, uintptr_t size, int prot, int flags)
+{
+    uint8_t *ptr;
+    uintptr_t head;
+
+#ifdef MAP_HUGETLB
+    ptr = mmap(start, size, prot, flags | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+        return ptr;
+    }
+#endif
+    if (start != NULL || (flags & MAP_FIXED)) {
+        ptr = mmap(start, size, prot, flags, -1, 0);
+    } else {
+        /* transparent huge pages are only used for aligned ranges,
+           so map a bit more and trim it to the huge page boundaries */
+        ptr = mmap(NULL, size + HUGE_PAGE_SIZE, prot, flags, -1, 0);
+        if (ptr == MAP_FAILED) {
+            return MAP_FAILED;
+        }
+        head = huge_page_align((uintptr_t)ptr) - (uintptr_t)ptr;
+        if (head != 0) {
+            munmap(ptr, head);
+        }
+        munmap(ptr + head + size, HUGE_PAGE_SIZE - head);
+        ptr += head;
+    }
+#ifdef MADV_HUGEPAGE
+    if (ptr != MAP_FAILED) {
+        madvise(ptr, size, MADV_HUGEPAGE);
+    }
+#endif
+    return ptr;
+}
+#endif
+
 static void code_gen_alloc()
 {
     code_gen_buffer_size = translation_cache_size;
@@ -344,13 +410,20 @@ static void code_gen_alloc()
     {
         int flags;
         void *start = NULL;
+        uintptr_t alignment = getpagesize();
 
         flags = MAP_PRIVATE | MAP_ANONYMOUS;
+        if (translation_cache_huge_pages) {
+            code_gen_buffer_size = huge_page_align(code_gen_buffer_size);
+            alignment = HUGE_PAGE_SIZE;
+        }
 #if defined(__x86_64__)
-        flags |= MAP_32BIT;
-        /* Cannot map more than that */
-        if (code_gen_buffer_size > (800 * 1024 * 1024)) {
-            code_gen_buffer_size = (800 * 1024 * 1024);
+        /* Ask for the buffer right below the library, so that calls to helpers
+           and jumps to the epilogue can still use 32-bit displacements.  This is
+           only a hint - the buffer may end up anywhere, in which case the backend
+           emits 64-bit calls and TBs out of direct jump range are not chained.  */
+        if ((uintptr_t)tcg->code_gen_prologue > code_gen_buffer_size + alignment) {
+            start = (void *)(((uintptr_t)tcg->code_gen_prologue - code_gen_buffer_size) & ~(alignment - 1));
         }
 #elif defined(__arm__)
         /* Map the buffer below 32M, so we can use direct calls and branches */
@@ -360,7 +433,11 @@ static void code_gen_alloc()
             code_gen_buffer_size = 16 * 1024 * 1024;
         }
 #endif
-        code_gen_buffer = mmap(start, code_gen_buffer_size, PROT_WRITE | PROT_READ | PROT_EXEC, flags, -1, 0);
+        if (translation_cache_huge_pages) {
+            code_gen_buffer = mmap_huge(start, code_gen_buffer_size, PROT_WRITE | PROT_READ | PROT_EXEC, flags);
+        } else {
+            code_gen_buffer = mmap(start, code_gen_buffer_size, PROT_WRITE | PROT_READ | PROT_EXEC, flags, -1, 0);
+        }
         // let's give some feedback about what size was actually used
         tlib_on_translation_cache_size_change(code_gen_buffer_size);
         if (code_gen_buffer == MAP_FAILED) {
@@ -391,6 +468,87 @@ void code_gen_free(void)
     tlib_free(tbs);
 }
 
+/* Zeroed memory for the host to keep the guest RAM in, backed by huge pages
+   where possible to cut down on the host TLB misses.  */
+void *ram_alloc(ram_addr_t size)
+{
+    if (size == 0) {
+        /* nothing to map, and munmap rejects a zero length */
+        return NULL;
+    }
+#ifdef _WIN32
+    void *ptr = tlib_malloc(size);
+    memset(ptr, 0, size);
+    return ptr;
+#else
+    void *ptr = mmap_huge(NULL, huge_page_align(size), PROT_WRITE | PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS);
+    return ptr == MAP_FAILED ? NULL : ptr;
+#endif
+}
+
+void ram_free(void *ptr, ram_addr_t size)
+{
+#ifdef _WIN32
+    tlib_free(ptr);
+#else
+    munmap(ptr, huge_page_align(size));
+#endif
+}
+
+/* Maps SIZE bytes of the file at PATH, starting at the page aligned OFFSET.
+   The pages are read in on the first access.  Writable mappings are
+   copy-on-write, so the file is never modified and simulations started from
+   the same image share its unmodified pages; read only mappings are shared
+   with every other mapping of the file.  The part of the region past the end
+   of the file reads as zeros.  */
+void *file_ram_map(const char *path, uint64_t offset, ram_addr_t size, int read_only)
+{
+#ifdef _WIN32
+    return NULL;
+#else
+    struct stat st;
+    uint64_t file_size;
+    uint8_t *ptr;
+    int prot = read_only ? PROT_READ : PROT_WRITE | PROT_READ;
+    int fd;
+
+    if (offset & (getpagesize() - 1)) {
+        return NULL;
+    }
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return NULL;
+    }
+    /* reserve the whole region first, the pages past the end of the file stay anonymous */
+    ptr = mmap(NULL, size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    file_size = (uint64_t)st.st_size > offset ? st.st_size - offset : 0;
+    if (file_size > size) {
+        file_size = size;
+    }
+    if (file_size != 0 && mmap(ptr, file_size, prot, (read_only ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED, fd, offset) == MAP_FAILED) {
+        munmap(ptr, size);
+        ptr = NULL;
+    }
+    close(fd);
+    return ptr;
+#endif
+}
+
+void file_ram_unmap(void *ptr, ram_addr_t size)
+{
+#ifndef _WIN32
+    munmap(ptr, size);
+#endif
+}
+
 TCGv_ptr cpu_env;
 
 /* Must be called before using the QEMU cpus.*/
@@ -423,8 +581,10 @@ static TranslationBlock *tb_alloc(target_ulong pc)
         return NULL;
     }
     tb = &tbs[nb_tbs++];
+    tb->generation++;
     tb->pc = pc;
     tb->cflags = 0;
+    tb->exec_count = 0;
     return tb;
 }
 
@@ -493,6 +653,8 @@ void tb_flush(CPUState *env1)
     page_flush_tb();
 
     code_gen_ptr = code_gen_buffer;
+    /* provisional TBs are gone, they will be requested again on the next miss */
+    nb_deferred_translations = 0;
     /* XXX: flush processor icache at this point if cache flush is
        expensive */
     tb_flush_count++;
@@ -615,6 +777,7 @@ void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr)
         tb1 = tb2;
     }
     tb->jmp_first = (TranslationBlock *)((uintptr_t)tb | 2); /* fail safe */
+    tb->generation++;
 
     tb_phys_invalidate_count++;
 }
@@ -675,7 +838,7 @@ static void build_page_bitmap(PageDesc *p)
     }
 }
 
-TranslationBlock *tb_gen_code(CPUState *env, target_ulong pc, target_ulong cs_base, int flags, uint16_t cflags)
+TranslationBlock *tb_gen_code(CPUState *env, target_ulong pc, target_ulong cs_base, uint64_t flags, uint32_t cflags)
 {
     TranslationBlock *tb;
     uint8_t *tc_ptr;
@@ -698,6 +861,10 @@ TranslationBlock *tb_gen_code(CPUState *env, target_ulong pc, target_ulong cs_ba
     tb->cs_base = cs_base;
     tb->flags = flags;
     tb->cflags = cflags;
+    if (tb_superblocks_allowed(env)) {
+        // recorded so that the state restoring retranslation takes the same jumps
+        tb->cflags |= CF_SUPERBLOCKS;
+    }
     cpu_gen_code(env, tb, &code_gen_size);
     code_gen_ptr = (void *)(((uintptr_t)code_gen_ptr + code_gen_size + CODE_GEN_ALIGN - 1) & ~(CODE_GEN_ALIGN - 1));
 
@@ -714,6 +881,90 @@ TranslationBlock *tb_gen_code(CPUState *env, target_ulong pc, target_ulong cs_ba
     return tb;
 }
 
+static inline int tb_deferred_is_pending(DeferredTranslation *req)
+{
+    return req->provisional_tb->generation == req->provisional_generation;
+}
+
+/* Generate an unoptimized placeholder TB for 'pc' and queue its optimized
+   translation, which is done later by tb_process_deferred_translations.
+   Returns NULL if the block should be translated right away instead: the
+   queue is full or 'pc' lies inside a block that is already queued, so
+   that the deferred translations do not overlap. */
+TranslationBlock *tb_gen_provisional_code(CPUState *env, target_ulong pc, target_ulong cs_base, uint64_t flags)
+{
+    DeferredTranslation *req;
+    TranslationBlock *tb;
+    int i;
+
+    if (nb_deferred_translations == DEFERRED_TRANSLATION_QUEUE_SIZE) {
+        return NULL;
+    }
+    req = NULL;
+    for (i = 0; i < nb_deferred_translations; i++) {
+        if (deferred_translations[i].pc == pc && deferred_translations[i].cs_base == cs_base &&
+            deferred_translations[i].flags == flags) {
+            /* the previous placeholder must have been invalidated in the meantime */
+            req = &deferred_translations[i];
+            break;
+        }
+        if (tb_deferred_is_pending(&deferred_translations[i]) && deferred_translations[i].cs_base == cs_base &&
+            deferred_translations[i].flags == flags && pc > deferred_translations[i].pc &&
+            pc - deferred_translations[i].pc < deferred_translations[i].provisional_tb->size) {
+            return NULL;
+        }
+    }
+    tb = tb_gen_code(env, pc, cs_base, flags, CF_PROVISIONAL);
+
+    if (req == NULL || nb_deferred_translations == 0) {
+        /* the queue could have been emptied by a flush in tb_gen_code */
+        req = &deferred_translations[nb_deferred_translations++];
+        req->pc = pc;
+        req->cs_base = cs_base;
+        req->flags = flags;
+    }
+    req->attempts = 0;
+    req->provisional_tb = tb;
+    req->provisional_generation = tb->generation;
+    return tb;
+}
+
+/* Replace provisional TBs with optimized blocks. This is called outside of
+   the execution loop, so a block is only translated if the CPU is in the
+   same state as when it was requested and all its code can be fetched
+   without refilling the TLB; the translation then stops at the first
+   instruction that is not cached (see CF_DEFERRED). */
+void tb_process_deferred_translations(CPUState *env)
+{
+    DeferredTranslation *req;
+    target_ulong pc, cs_base;
+    uint64_t flags;
+    int i, kept, flush_count;
+
+    tb_get_cpu_state(env, &pc, &cs_base, &flags);
+    flush_count = tb_flush_count;
+    kept = 0;
+    for (i = 0; i < nb_deferred_translations; i++) {
+        req = &deferred_translations[i];
+        if (!tb_deferred_is_pending(req)) {
+            /* invalidated in the meantime - nothing to replace */
+            continue;
+        }
+        if (req->cs_base == cs_base && req->flags == flags && tb_code_fetch_is_cached(env, req->pc)) {
+            tb_phys_invalidate(req->provisional_tb, -1);
+            tb_gen_code(env, req->pc, req->cs_base, req->flags, CF_DEFERRED);
+            if (tb_flush_count != flush_count) {
+                /* the whole queue was dropped by the flush */
+                return;
+            }
+        } else if (++req->attempts < DEFERRED_TRANSLATION_MAX_ATTEMPTS) {
+            deferred_translations[kept++] = *req;
+        }
+        /* otherwise give up and keep using the placeholder */
+    }
+    nb_deferred_translations = kept;
+}
+
 /* invalidate all TBs which intersect with the target physical page
    starting in range [start;end[. NOTE: start and end must refer to
    the same physical page. 'is_cpu_write_access' should be true if called
@@ -732,7 +983,7 @@ void tb_invalidate_phys_page_range_inner(tb_page_addr_t start, tb_page_addr_t en
     int current_tb_modified = 0;
     target_ulong current_pc = 0;
     target_ulong current_cs_base = 0;
-    int current_flags = 0;
+    uint64_t current_flags = 0;
 #endif /* TARGET_HAS_PRECISE_SMC */
 
     p = page_find(start >> TARGET_PAGE_BITS);
@@ -781,7 +1032,7 @@ void tb_invalidate_phys_page_range_inner(tb_page_addr_t start, tb_page_addr_t en
 
                 current_tb_modified = 1;
                 cpu_restore_state(env, current_tb, env->mem_io_pc);
-                cpu_get_tb_cpu_state(env, &current_pc, &current_cs_base, &current_flags);
+                tb_get_cpu_state(env, &current_pc, &current_cs_base, &current_flags);
             }
 #endif /* TARGET_HAS_PRECISE_SMC */
             /* we need to do that to handle the case where a signal
@@ -990,6 +1241,104 @@ int cpu_breakpoint_insert(CPUState *env, target_ulong pc, int flags, CPUBreakpoi
     return 0;
 }
 
+/* Add a hook called before executing the instruction at 'pc'. Only the blocks
+   containing 'pc' are retranslated to call it. When called while a block is
+   executing, the hook takes effect once the block exits.  */
+void cpu_pc_hook_insert(CPUState *env, target_ulong pc, uint32_t callback_id)
+{
+    PCHook *hooks = env->pc_hooks;
+    int i;
+
+    /* hooks registered at the same pc are called in the registration order */
+    i = pc_hooks_lower_bound(env, pc);
+    while (i < env->pc_hooks_count && hooks[i].pc == pc) {
+        i++;
+    }
+    if (hooks == NULL) {
+        hooks = tlib_malloc(sizeof(PCHook));
+    } else {
+        hooks = tlib_realloc(hooks, (env->pc_hooks_count + 1) * sizeof(PCHook));
+    }
+    memmove(&hooks[i + 1], &hooks[i], (env->pc_hooks_count - i) * sizeof(PCHook));
+    hooks[i].pc = pc;
+    hooks[i].callback_id = callback_id;
+    hooks[i].added = 0;
+    hooks[i].removed = 0;
+    env->pc_hooks = hooks;
+    env->pc_hooks_count++;
+
+    if (env->current_tb != NULL) {
+        /* the executing block must be retranslated the same way if it faults */
+        hooks[i].added = 1;
+        env->pc_hooks_pending = 1;
+        /* leave the chained blocks so that the change is applied soon */
+        env->tb_restart_request = 1;
+        return;
+    }
+    breakpoint_invalidate(env, pc);
+}
+
+/* Remove a specific pc hook. When called while a block is executing, the hook
+   is no longer called but stays in the table until the block exits.  */
+int cpu_pc_hook_remove(CPUState *env, target_ulong pc, uint32_t callback_id)
+{
+    PCHook *hook;
+    int i;
+
+    for (i = pc_hooks_lower_bound(env, pc); i < env->pc_hooks_count && env->pc_hooks[i].pc == pc; i++) {
+        hook = &env->pc_hooks[i];
+        if (hook->callback_id != callback_id || hook->removed) {
+            continue;
+        }
+        if (env->current_tb != NULL && !hook->added) {
+            hook->removed = 1;
+            env->pc_hooks_pending = 1;
+            env->tb_restart_request = 1;
+            return 0;
+        }
+        env->pc_hooks_count--;
+        memmove(&env->pc_hooks[i], &env->pc_hooks[i + 1], (env->pc_hooks_count - i) * sizeof(PCHook));
+        if (env->current_tb == NULL && !pc_has_hooks(env, pc)) {
+            breakpoint_invalidate(env, pc);
+        }
+        return 0;
+    }
+    return -ENOENT;
+}
+
+/* Apply the hook changes made while executing a block, called once it exits.  */
+void cpu_pc_hooks_apply_pending(CPUState *env)
+{
+    PCHook hook;
+    int i, count = 0;
+
+    env->pc_hooks_pending = 0;
+    for (i = 0; i < env->pc_hooks_count; i++) {
+        hook = env->pc_hooks[i];
+        if (hook.added || hook.removed) {
+            breakpoint_invalidate(env, hook.pc);
+        }
+        if (!hook.removed) {
+            hook.added = 0;
+            env->pc_hooks[count++] = hook;
+        }
+    }
+    env->pc_hooks_count = count;
+}
+
+/* Remove all pc hooks.  */
+void cpu_pc_hooks_remove_all(CPUState *env)
+{
+    if (env->pc_hooks == NULL) {
+        return;
+    }
+    tlib_free(env->pc_hooks);
+    env->pc_hooks = NULL;
+    env->pc_hooks_count = 0;
+    env->pc_hooks_pending = 0;
+    tb_flush(env);
+}
+
 /* Remove a specific breakpoint.  */
 int cpu_breakpoint_remove(CPUState *env, target_ulong pc, int flags)
 {
@@ -1169,10 +1518,10 @@ static void tlb_unprotect_code_phys(CPUState *env, ram_addr_t ram_addr, target_u
 static inline void tlb_reset_dirty_range(CPUTLBEntry *tlb_entry, uintptr_t start, uintptr_t length)
 {
     uintptr_t addr;
-    if ((tlb_entry->addr_write & ~TARGET_PAGE_MASK) == IO_MEM_RAM) {
+    if ((tlb_entry->addr_write & ~(TARGET_PAGE_MASK | TLB_WATCHED)) == IO_MEM_RAM) {
         addr = (tlb_entry->addr_write & TARGET_PAGE_MASK) + tlb_entry->addend;
         if ((addr - start) < length) {
-            tlb_entry->addr_write = (tlb_entry->addr_write & TARGET_PAGE_MASK) | TLB_NOTDIRTY;
+            tlb_entry->addr_write = (tlb_entry->addr_write & (TARGET_PAGE_MASK | TLB_WATCHED)) | TLB_NOTDIRTY;
         }
     }
 }
@@ -1211,8 +1560,8 @@ void cpu_physical_memory_reset_dirty(ram_addr_t start, ram_addr_t end, int dirty
 
 static inline void tlb_set_dirty1(CPUTLBEntry *tlb_entry, target_ulong vaddr)
 {
-    if (tlb_entry->addr_write == (vaddr | TLB_NOTDIRTY)) {
-        tlb_entry->addr_write = vaddr;
+    if ((tlb_entry->addr_write & ~TLB_WATCHED) == (vaddr | TLB_NOTDIRTY)) {
+        tlb_entry->addr_write &= ~TLB_NOTDIRTY;
     }
 }
 
@@ -1318,6 +1667,12 @@ void tlb_set_page(CPUState *env, target_ulong vaddr, target_phys_addr_t paddr, i
 
     code_address = address;
 
+    if (env->tlib_is_on_memory_access_enabled && env->memory_access_hook_ranges_count != 0 &&
+        memory_access_hook_ranges_overlap(env, vaddr & TARGET_PAGE_MASK, (vaddr & TARGET_PAGE_MASK) + TARGET_PAGE_SIZE - 1)) {
+        /* keep the data accesses on the slow path; instruction fetches are not reported */
+        address |= TLB_WATCHED;
+    }
+
     if (tlib_is_io_accessed(vaddr)) {
         iotlb = paddr;
         address |= TLB_MMIO;
@@ -1352,6 +1707,60 @@ void tlb_set_page(CPUState *env, target_ulong vaddr, target_phys_addr_t paddr, i
     }
 }
 
+/* Add [start, end] to the memory access hook ranges, merging it with the
+   ranges it overlaps or adjoins so that the array stays sorted and disjoint. */
+void memory_access_hook_range_add(CPUState *env, target_ulong start, target_ulong end)
+{
+    MemoryAccessHookRange *ranges = env->memory_access_hook_ranges;
+    int count = env->memory_access_hook_ranges_count;
+    int first, last;
+
+    /* skip the ranges that end before 'start', leaving a gap */
+    first = 0;
+    while (first < count && ranges[first].end < start && ranges[first].end + 1 < start) {
+        first++;
+    }
+    /* ranges [first, last) are merged with the new one */
+    for (last = first; last < count && (end == (target_ulong)-1 || ranges[last].start <= end + 1); last++) {
+        if (ranges[last].start < start) {
+            start = ranges[last].start;
+        }
+        if (ranges[last].end > end) {
+            end = ranges[last].end;
+        }
+    }
+
+    if (last == first) {
+        if (ranges == NULL) {
+            ranges = tlib_malloc(sizeof(MemoryAccessHookRange));
+        } else {
+            ranges = tlib_realloc(ranges, (count + 1) * sizeof(MemoryAccessHookRange));
+        }
+        memmove(&ranges[first + 1], &ranges[first], (count - first) * sizeof(MemoryAccessHookRange));
+        count++;
+    } else {
+        memmove(&ranges[first + 1], &ranges[last], (count - last) * sizeof(MemoryAccessHookRange));
+        count -= last - first - 1;
+    }
+    ranges[first].start = start;
+    ranges[first].end = end;
+
+    env->memory_access_hook_ranges = ranges;
+    env->memory_access_hook_ranges_count = count;
+    /* pages overlapping the new range have to be marked as watched */
+    tlb_flush(env, 1);
+}
+
+void memory_access_hook_ranges_clear(CPUState *env)
+{
+    if (env->memory_access_hook_ranges != NULL) {
+        tlib_free(env->memory_access_hook_ranges);
+    }
+    env->memory_access_hook_ranges = NULL;
+    env->memory_access_hook_ranges_count = 0;
+    tlb_flush(env, 1);
+}
+
 /* register physical memory.
    For RAM, 'size' must be a multiple of the target page size.
    If (phys_offset & ~TARGET_PAGE_MASK) != 0, then it is an
@@ -1414,13 +1823,148 @@ ram_addr_t cpu_get_physical_page_desc(target_phys_addr_t addr)
     return p->phys_offset;
 }
 
+/* RAM regions registered by the host, sorted by guest offset and disjoint.
+   They let us translate RAM addresses without calling back into the host;
+   addresses outside of them still go through the callbacks.  */
+typedef struct HostMemoryRegion {
+    ram_addr_t guest_offset;
+    ram_addr_t size;
+    uint8_t *host_ptr;
+} HostMemoryRegion;
+
+static HostMemoryRegion *host_memory_regions;
+static int host_memory_regions_count;
+/* index of the region that resolved the last lookup */
+static int host_memory_last_region;
+
+static void host_memory_regions_changed(void)
+{
+    host_memory_last_region = 0;
+    /* the TLB entries cache host addresses */
+    if (cpu) {
+        tlb_flush(cpu, 1);
+    }
+}
+
+static void host_memory_region_remove_at(int i)
+{
+    host_memory_regions_count--;
+    memmove(&host_memory_regions[i], &host_memory_regions[i + 1], (host_memory_regions_count - i) * sizeof(HostMemoryRegion));
+}
+
+/* Replaces the mappings of the overlapped regions.  */
+void host_memory_region_register(ram_addr_t guest_offset, ram_addr_t size, void *host_ptr)
+{
+    HostMemoryRegion *region;
+    int i;
+
+    for (i = 0; i < host_memory_regions_count; i++) {
+        region = &host_memory_regions[i];
+        if (region->guest_offset + region->size <= guest_offset) {
+            continue;
+        }
+        if (region->guest_offset >= guest_offset + size) {
+            break;
+        }
+        host_memory_region_remove_at(i--);
+    }
+    if (host_memory_regions == NULL) {
+        host_memory_regions = tlib_malloc(sizeof(HostMemoryRegion));
+    } else {
+        host_memory_regions = tlib_realloc(host_memory_regions, (host_memory_regions_count + 1) * sizeof(HostMemoryRegion));
+    }
+    memmove(&host_memory_regions[i + 1], &host_memory_regions[i], (host_memory_regions_count - i) * sizeof(HostMemoryRegion));
+    region = &host_memory_regions[i];
+    region->guest_offset = guest_offset;
+    region->size = size;
+    region->host_ptr = host_ptr;
+    host_memory_regions_count++;
+    host_memory_regions_changed();
+}
+
+int host_memory_region_unregister(ram_addr_t guest_offset)
+{
+    int i;
+
+    for (i = 0; i < host_memory_regions_count; i++) {
+        if (host_memory_regions[i].guest_offset == guest_offset) {
+            host_memory_region_remove_at(i);
+            host_memory_regions_changed();
+            return 0;
+        }
+    }
+    return -ENOENT;
+}
+
+void host_memory_regions_clear(void)
+{
+    if (host_memory_regions == NULL) {
+        return;
+    }
+    tlib_free(host_memory_regions);
+    host_memory_regions = NULL;
+    host_memory_regions_count = 0;
+    host_memory_regions_changed();
+}
+
+static inline HostMemoryRegion *host_memory_region_find(ram_addr_t addr)
+{
+    HostMemoryRegion *region;
+    int low, high, mid;
+
+    if (host_memory_regions_count == 0) {
+        return NULL;
+    }
+    region = &host_memory_regions[host_memory_last_region];
+    if (likely(addr - region->guest_offset < region->size)) {
+        return region;
+    }
+    low = 0;
+    high = host_memory_regions_count - 1;
+    while (low <= high) {
+        mid = (low + high) / 2;
+        region = &host_memory_regions[mid];
+        if (addr < region->guest_offset) {
+            high = mid - 1;
+        } else if (addr - region->guest_offset >= region->size) {
+            low = mid + 1;
+        } else {
+            host_memory_last_region = mid;
+            return region;
+        }
+    }
+    return NULL;
+}
+
 void *get_ram_ptr(ram_addr_t addr)
 {
+    HostMemoryRegion *region = host_memory_region_find(addr);
+
+    if (likely(region != NULL)) {
+        return region->host_ptr + (addr - region->guest_offset);
+    }
     return tlib_guest_offset_to_host_ptr(addr);
 }
 
 ram_addr_t ram_addr_from_host(void *ptr)
 {
+    HostMemoryRegion *region;
+    int i;
+
+    /* the host pointers are not sorted, but there are only a few regions */
+    if (host_memory_regions_count != 0) {
+        region = &host_memory_regions[host_memory_last_region];
+        if ((uint8_t *)ptr >= region->host_ptr && (uint8_t *)ptr - region->host_ptr < region->size) {
+            return region->guest_offset + ((uint8_t *)ptr - region->host_ptr);
+        }
+        for (i = 0; i < host_memory_regions_count; i++) {
+            region = &host_memory_regions[i];
+            if ((uint8_t *)ptr >= region->host_ptr && (uint8_t *)ptr - region->host_ptr < region->size) {
+                host_memory_last_region = i;
+                return region->guest_offset + ((uint8_t *)ptr - region->host_ptr);
+            }
+        }
+    }
     return tlib_host_ptr_to_guest_offset(ptr);
 }
 
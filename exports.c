@@ -23,6 +23,7 @@
 #include "tcg.h"
 #include "tcg-additional.h"
 #include "exec-all.h"
+#include "call_trace.h"
 
 static tcg_t stcg;
 
@@ -134,6 +135,10 @@ static void free_phys_dirty()
 
 void tlib_dispose()
 {
+    memory_access_hook_ranges_clear(cpu);
+    cpu_pc_hooks_remove_all(cpu);
+    call_trace_disable(cpu);
+    host_memory_regions_clear();
     tlib_arch_dispose();
     code_gen_free();
     free_all_page_descriptors();
@@ -210,7 +215,7 @@ extern void *global_retaddr;
 void tlib_restart_translation_block()
 {
     target_ulong pc, cs_base;
-    int cpu_flags;
+    uint64_t cpu_flags;
     TranslationBlock *tb;
     int executed_instructions = -1;
 
@@ -219,7 +224,7 @@ void tlib_restart_translation_block()
         executed_instructions = cpu_restore_state_and_restore_instructions_count(cpu, tb, (uintptr_t)global_retaddr);
     }
 
-    cpu_get_tb_cpu_state(cpu, &pc, &cs_base, &cpu_flags);
+    tb_get_cpu_state(cpu, &pc, &cs_base, &cpu_flags);
     tb_phys_invalidate(cpu->current_tb, -1);
     tb_gen_code(cpu, pc, cs_base, cpu_flags, 0);
 
@@ -246,7 +251,7 @@ uint32_t tlib_get_page_size()
     return TARGET_PAGE_SIZE;
 }
 
-void tlib_map_range(uint64_t start_addr, uint64_t length)
+static void map_range(uint64_t start_addr, uint64_t length, ram_addr_t io_type)
 {
     ram_addr_t phys_offset = start_addr;
     ram_addr_t size = length;
@@ -269,7 +274,43 @@ void tlib_map_range(uint64_t start_addr, uint64_t length)
         dirty_ram.current_size = new_size;
     }
     memset(dirty_ram.phys_dirty + array_start_addr, 0xff, array_size);
-    cpu_register_physical_memory(start_addr, size, phys_offset | IO_MEM_RAM);
+    cpu_register_physical_memory(start_addr, size, phys_offset | io_type);
+}
+
+void tlib_map_range(uint64_t start_addr, uint64_t length)
+{
+    map_range(start_addr, length, IO_MEM_RAM);
+}
+
+// Let tlib resolve the host pointers of the mapped RAM without calling
+// `tlib_guest_offset_to_host_ptr`/`tlib_host_ptr_to_guest_offset`.
+// Registering a region again, e.g. after a remap, replaces the overlapped ones.
+void tlib_register_host_memory_region(uint64_t guest_offset, uint64_t size, void *host_ptr)
+{
+    if (size == 0) {
+        return;
+    }
+    host_memory_region_register(guest_offset, size, host_ptr);
+}
+
+void tlib_unregister_host_memory_region(uint64_t guest_offset)
+{
+    host_memory_region_unregister(guest_offset);
+}
+
+// Allocates zeroed memory for the guest RAM, backed by huge pages when the host OS provides them.
+// Returns NULL on failure or when `size` is 0; the memory is released with `tlib_free_ram` using the same size.
+void *tlib_allocate_ram(uint64_t size)
+{
+    return ram_alloc(size);
+}
+
+void tlib_free_ram(void *ptr, uint64_t size)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    ram_free(ptr, size);
 }
 
 void tlib_unmap_range(uint64_t start, uint64_t end)
@@ -286,6 +327,59 @@ void tlib_unmap_range(uint64_t start, uint64_t end)
     }
 }
 
+// Maps `length` bytes of an image file, starting at the page aligned `file_offset`, as RAM at `start_addr`.
+// The pages are loaded lazily and guest writes go to private copies, the file itself is never modified.
+// Returns the host pointer of the region, so the host can access it too, or NULL on failure.
+void *tlib_map_file_range(uint64_t start_addr, uint64_t length, const char *path, uint64_t file_offset)
+{
+    void *host_ptr;
+
+    if (length == 0) {
+        return NULL;
+    }
+    host_ptr = file_ram_map(path, file_offset, length, 0);
+    if (host_ptr == NULL) {
+        return NULL;
+    }
+    map_range(start_addr, length, IO_MEM_RAM);
+    host_memory_region_register(start_addr, length, host_ptr);
+    return host_ptr;
+}
+
+// Maps `length` bytes of an image file, starting at the page aligned `file_offset`, as ROM at `start_addr`.
+// The pages are shared with every other mapping of the file, so identical machines loading the same image,
+// in this process or in others, keep a single copy of it in the host memory.
+// Guest writes to the range are passed to the `tlib_write_*` callbacks, like writes to unmapped memory.
+// Returns the host pointer of the read-only region or NULL on failure.
+void *tlib_map_shared_rom(uint64_t start_addr, uint64_t length, const char *path, uint64_t file_offset)
+{
+    void *host_ptr;
+
+    if (length == 0) {
+        return NULL;
+    }
+    host_ptr = file_ram_map(path, file_offset, length, 1);
+    if (host_ptr == NULL) {
+        return NULL;
+    }
+    map_range(start_addr, length, IO_MEM_ROM);
+    host_memory_region_register(start_addr, length, host_ptr);
+    return host_ptr;
+}
+
+// Drops the region mapped with `tlib_map_file_range` or `tlib_map_shared_rom`, together with the guest modifications.
+void tlib_unmap_file_range(uint64_t start_addr, uint64_t length, void *host_ptr)
+{
+    if (host_ptr == NULL || length == 0) {
+        return;
+    }
+    // the code translated from the image must not outlive it
+    tb_invalidate_phys_page_range_inner(start_addr, start_addr + length, 0, 0);
+    tlib_unmap_range(start_addr, start_addr + length - 1);
+    host_memory_region_unregister(start_addr);
+    file_ram_unmap(host_ptr, length);
+}
+
 uint32_t tlib_is_range_mapped(uint64_t start, uint64_t end)
 {
     PhysPageDesc *pd;
@@ -338,6 +432,19 @@ void tlib_remove_breakpoint(uint64_t address)
     cpu_breakpoint_remove(cpu, address, BP_GDB);
 }
 
+// Call `tlib_on_pc_hook` before executing the instruction at `pc`; a non-zero return value
+// stops the execution before that instruction and returns to the host.
+// Only the blocks containing `pc` are retranslated, others keep running without the hook check.
+void tlib_add_pc_hook(uint64_t pc, uint32_t callback_id)
+{
+    cpu_pc_hook_insert(cpu, pc, callback_id);
+}
+
+void tlib_remove_pc_hook(uint64_t pc, uint32_t callback_id)
+{
+    cpu_pc_hook_remove(cpu, pc, callback_id);
+}
+
 uintptr_t translation_cache_size;
 
 void tlib_set_translation_cache_size(uintptr_t size)
@@ -345,6 +452,14 @@ void tlib_set_translation_cache_size(uintptr_t size)
     translation_cache_size = size;
 }
 
+uint32_t translation_cache_huge_pages;
+
+// Has to be set before `tlib_init`, the translation cache is allocated there.
+void tlib_set_translation_cache_huge_pages(uint32_t val)
+{
+    translation_cache_huge_pages = !!val;
+}
+
 void tlib_invalidate_translation_cache()
 {
     if (cpu) {
@@ -395,6 +510,21 @@ uint32_t tlib_get_chaining_enabled()
     return !cpu->chaining_disabled;
 }
 
+// translate through unconditional direct jumps; takes effect for the blocks translated from now on
+void tlib_set_superblocks_enabled(uint32_t val)
+{
+    if (!cpu->superblocks_disabled && !val) {
+        // drop the blocks already translated through jumps
+        tb_flush(cpu);
+    }
+    cpu->superblocks_disabled = !val;
+}
+
+uint32_t tlib_get_superblocks_enabled()
+{
+    return !cpu->superblocks_disabled;
+}
+
 void tlib_set_tb_cache_enabled(uint32_t val)
 {
     cpu->tb_cache_disabled = !val;
@@ -405,16 +535,90 @@ uint32_t tlib_get_tb_cache_enabled()
     return !cpu->tb_cache_disabled;
 }
 
+void tlib_set_deferred_translation_enabled(uint32_t val)
+{
+    if (cpu->deferred_translation_enabled && !val) {
+        // drop the unoptimized placeholder blocks that would never be replaced
+        tb_flush(cpu);
+    }
+    cpu->deferred_translation_enabled = !!val;
+}
+
+uint32_t tlib_get_deferred_translation_enabled()
+{
+    return cpu->deferred_translation_enabled;
+}
+
+// translates the blocks queued while deferred translation is enabled; meant to be called
+// between executions when the CPU thread would otherwise wait, e.g. for the other cores
+// at a synchronization point, as the translator cannot run concurrently with the execution
+void tlib_process_deferred_translations()
+{
+    if (cpu->deferred_translation_enabled) {
+        tb_process_deferred_translations(cpu);
+    }
+}
+
+void tlib_set_tier2_threshold(uint32_t threshold)
+{
+    if (cpu->tb_tier2_threshold && !threshold) {
+        // drop the unoptimized blocks that would never be promoted
+        tb_flush(cpu);
+    }
+    cpu->tb_tier2_threshold = threshold;
+}
+
+uint32_t tlib_get_tier2_threshold()
+{
+    return cpu->tb_tier2_threshold;
+}
+
 void tlib_set_block_finished_hook_present(uint32_t val)
 {
+    if (!cpu->block_finished_hook_present && val && !cpu->superblocks_disabled) {
+        // superblocks would hide the boundaries of the blocks they were translated through
+        tb_flush(cpu);
+    }
     cpu->block_finished_hook_present = !!val;
 }
 
 void tlib_set_block_begin_hook_present(uint32_t val)
 {
+    if (!cpu->block_begin_hook_present && val && !cpu->superblocks_disabled) {
+        // superblocks would hide the boundaries of the blocks they were translated through
+        tb_flush(cpu);
+    }
     cpu->block_begin_hook_present = !!val;
 }
 
+// Trace the guest calls and returns into a ring buffer of `capacity` events, 0 disables the tracing.
+// The events are `CallTraceEvent` structures, see call_trace.h.
+void tlib_set_call_trace_enabled(uint32_t capacity)
+{
+    int was_enabled = cpu->call_trace != NULL;
+
+    if (capacity == 0) {
+        call_trace_disable(cpu);
+    } else {
+        call_trace_enable(cpu, capacity);
+    }
+    if (was_enabled != (cpu->call_trace != NULL)) {
+        // the tracing code is generated at translation time
+        tb_flush(cpu);
+    }
+}
+
+// Move up to `max_events` oldest events to `buffer`, returns the number of events moved.
+uint32_t tlib_drain_call_trace(void *buffer, uint32_t max_events)
+{
+    return call_trace_drain(cpu, buffer, max_events);
+}
+
+uint64_t tlib_get_call_trace_dropped_events()
+{
+    return cpu->call_trace == NULL ? 0 : cpu->call_trace->dropped_events;
+}
+
 int32_t tlib_set_return_on_exception(int32_t value)
 {
     int32_t previousValue = cpu->return_on_exception;
@@ -490,7 +694,40 @@ void tlib_set_interrupt_end_hook_present(uint32_t val)
 
 void tlib_on_memory_access_event_enabled(int32_t value)
 {
+    if (cpu->tlib_is_on_memory_access_enabled == !!value) {
+        return;
+    }
     cpu->tlib_is_on_memory_access_enabled = !!value;
+    // the setting is part of the TB key; leave the chained blocks so that
+    // the next lookup picks the blocks translated for the new setting
+    cpu->tb_restart_request = 1;
+    if (cpu->memory_access_hook_ranges_count != 0) {
+        // watched pages are only marked in the TLB while the hooks are enabled
+        tlb_flush(cpu, 1);
+    }
+}
+
+// Limit the accesses reported by `tlib_on_memory_access` to the registered ranges.
+// Only the pages overlapping them leave the fast path, other accesses are not reported.
+void tlib_add_memory_access_hook_range(uint64_t start, uint64_t length)
+{
+    target_ulong last = (target_ulong)-1;
+
+    if (length == 0 || start > last) {
+        tlib_printf(LOG_LEVEL_WARNING, "Ignoring an empty or out of range memory access hook range");
+        return;
+    }
+    // ranges reaching past the end of the address space are clamped
+    if (length - 1 < last - start) {
+        last = start + length - 1;
+    }
+    memory_access_hook_range_add(cpu, start, last);
+}
+
+// Report all the accesses going through the softmmu helpers again.
+void tlib_clear_memory_access_hook_ranges()
+{
+    memory_access_hook_ranges_clear(cpu);
 }
 
 void tlib_clean_wfi_proc_state(void)
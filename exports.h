@@ -28,6 +28,13 @@ int32_t tlib_is_wfi(void);
 
 uint32_t tlib_get_page_size(void);
 void tlib_map_range(uint64_t start_addr, uint64_t length);
+void tlib_register_host_memory_region(uint64_t guest_offset, uint64_t size, void *host_ptr);
+void tlib_unregister_host_memory_region(uint64_t guest_offset);
+void *tlib_allocate_ram(uint64_t size);
+void tlib_free_ram(void *ptr, uint64_t size);
+void *tlib_map_file_range(uint64_t start_addr, uint64_t length, const char *path, uint64_t file_offset);
+void *tlib_map_shared_rom(uint64_t start_addr, uint64_t length, const char *path, uint64_t file_offset);
+void tlib_unmap_file_range(uint64_t start_addr, uint64_t length, void *host_ptr);
 void tlib_unmap_range(uint64_t start, uint64_t end);
 uint32_t tlib_is_range_mapped(uint64_t start, uint64_t end);
 
@@ -40,11 +47,14 @@ int32_t tlib_is_irq_set(void);
 
 void tlib_add_breakpoint(uint64_t address);
 void tlib_remove_breakpoint(uint64_t address);
+void tlib_add_pc_hook(uint64_t pc, uint32_t callback_id);
+void tlib_remove_pc_hook(uint64_t pc, uint32_t callback_id);
 void tlib_set_block_begin_hook_present(uint32_t val);
 
 uint64_t tlib_get_total_executed_instructions(void);
 
 void tlib_set_translation_cache_size(uintptr_t size);
+void tlib_set_translation_cache_huge_pages(uint32_t val);
 void tlib_invalidate_translation_cache(void);
 
 int tlib_restore_context(void);
@@ -54,11 +64,25 @@ int32_t tlib_get_state_size(void);
 void tlib_set_chaining_enabled(uint32_t val);
 uint32_t tlib_get_chaining_enabled(void);
 
+void tlib_set_superblocks_enabled(uint32_t val);
+uint32_t tlib_get_superblocks_enabled(void);
+
 void tlib_set_tb_cache_enabled(uint32_t val);
 uint32_t tlib_get_tb_cache_enabled(void);
 
+void tlib_set_deferred_translation_enabled(uint32_t val);
+uint32_t tlib_get_deferred_translation_enabled(void);
+void tlib_process_deferred_translations(void);
+
+void tlib_set_tier2_threshold(uint32_t threshold);
+uint32_t tlib_get_tier2_threshold(void);
+
 void tlib_set_block_finished_hook_present(uint32_t val);
 
+void tlib_set_call_trace_enabled(uint32_t capacity);
+uint32_t tlib_drain_call_trace(void *buffer, uint32_t max_events);
+uint64_t tlib_get_call_trace_dropped_events(void);
+
 int32_t tlib_set_return_on_exception(int32_t value);
 void tlib_flush_page(uint64_t address);
 
@@ -3,6 +3,7 @@
 #include "callbacks.h"
 #include "debug.h"
 #include "atomic.h"
+#include "call_trace.h"
 
 // verify if there are instructions left to execute, update instructions count
 // and trim the block and exit to the main loop if necessary
@@ -13,6 +14,13 @@ void HELPER(prepare_block_for_execution)(void *tb)
     uint64_t instructions_left = cpu->instructions_count_threshold - cpu->instructions_count_value;
     uint64_t current_block_size = cpu->current_tb->icount;
 
+    if (unlikely(cpu->instructions_count_alarm != 0 && cpu->instructions_count_total_value >= cpu->instructions_count_alarm)) {
+        // leave the chained blocks so that the alarm is handled by the arch-specific `process_interrupt`
+        cpu->instructions_count_alarm = 0;
+        cpu->interrupt_request |= CPU_INTERRUPT_ALARM;
+        cpu->tb_restart_request = 1;
+    }
+
     if (instructions_left == 0) {
         // setting `tb_restart_request` to 1 will stop executing this block at the end of the header
         cpu->tb_restart_request = 1;
@@ -20,6 +28,11 @@ void HELPER(prepare_block_for_execution)(void *tb)
         // invalidate this block and jump back to the main loop
         tb_phys_invalidate(cpu->current_tb, -1);
         cpu->tb_restart_request = 1;
+    } else if ((cpu->current_tb->cflags & CF_TIER1) && ++cpu->current_tb->exec_count >= cpu->tb_tier2_threshold) {
+        // the block is hot - drop the first tier code and let the main loop retranslate it with optimizations
+        tb_phys_invalidate(cpu->current_tb, -1);
+        tb_promotion_push(cpu, cpu->current_tb->pc);
+        cpu->tb_restart_request = 1;
     }
 }
 
@@ -40,6 +53,52 @@ void HELPER(block_finished_event)(target_ulong address, uint32_t executed_instru
     tlib_on_block_finished(address, executed_instructions);
 }
 
+void HELPER(pc_hook_event)(target_ulong pc)
+{
+    int i, n;
+    PCHook *hook;
+    uint32_t stop = 0;
+
+    // the hooks are only marked as removed while the block executes, but the callbacks
+    // may add new ones, so the position is recomputed after each call
+    for (n = 0;; n++) {
+        i = pc_hooks_lower_bound(cpu, pc) + n;
+        if (i >= cpu->pc_hooks_count || cpu->pc_hooks[i].pc != pc) {
+            break;
+        }
+        hook = &cpu->pc_hooks[i];
+        if (!hook->added && !hook->removed) {
+            stop |= tlib_on_pc_hook(pc, hook->callback_id);
+        }
+    }
+    if (stop) {
+        // return to the host before executing the instruction, which the restored state counts as executed
+        uintptr_t retaddr = (uintptr_t)GETPC();
+        TranslationBlock *tb = tb_find_pc(retaddr);
+        int dirty = tb->instructions_count_dirty;
+        int executed_instructions = cpu_restore_state_and_restore_instructions_count(cpu, tb, retaddr) - 1;
+        if (dirty) {
+            cpu->instructions_count_value--;
+            cpu->instructions_count_total_value--;
+        }
+        if (cpu->block_finished_hook_present) {
+            tlib_on_block_finished(pc, executed_instructions);
+        }
+        cpu->exit_request = 1;
+        cpu_loop_exit_without_hook(cpu);
+    }
+}
+
+void HELPER(call_trace_call)(target_ulong target, target_ulong return_address)
+{
+    call_trace_push(cpu, target, return_address);
+}
+
+void HELPER(call_trace_return)(target_ulong target)
+{
+    call_trace_pop(cpu, target);
+}
+
 void HELPER(abort)(void) {
     tlib_abort("aborted by gen_abort!");
 }
@@ -0,0 +1,49 @@
+#if !defined (__CALL_TRACE_H__)
+#define __CALL_TRACE_H__
+
+#include <stdint.h>
+
+/* number of frames kept on the shadow stack, the oldest ones are dropped
+   when the guest nests deeper */
+#define CALL_TRACE_STACK_SIZE 256
+
+#define CALL_TRACE_ENTRY      0
+#define CALL_TRACE_EXIT       1
+
+/* layout shared with the host draining the events */
+typedef struct CallTraceEvent {
+    uint64_t function;       /* address of the called function */
+    uint64_t return_address; /* address the function returns to */
+    uint64_t timestamp;      /* executed instructions count at the event */
+    uint64_t duration;       /* for exits, instructions executed since the entry */
+    uint32_t type;           /* CALL_TRACE_ENTRY or CALL_TRACE_EXIT */
+    uint32_t depth;          /* call depth, the outermost traced call has depth 0 */
+} CallTraceEvent;
+
+typedef struct CallTraceFrame {
+    target_ulong function;
+    target_ulong return_address;
+    uint64_t timestamp;
+} CallTraceFrame;
+
+typedef struct CallTrace {
+    CallTraceFrame stack[CALL_TRACE_STACK_SIZE];
+    /* can exceed CALL_TRACE_STACK_SIZE, the stack wraps around */
+    uint32_t depth;
+    /* ring buffer of events not yet drained by the host */
+    CallTraceEvent *events;
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    uint64_t dropped_events;
+} CallTrace;
+
+struct CPUState;
+
+void call_trace_enable(struct CPUState *env, uint32_t capacity);
+void call_trace_disable(struct CPUState *env);
+void call_trace_push(struct CPUState *env, target_ulong function, target_ulong return_address);
+void call_trace_pop(struct CPUState *env, target_ulong target);
+uint32_t call_trace_drain(struct CPUState *env, CallTraceEvent *buffer, uint32_t max_events);
+
+#endif // __CALL_TRACE_H__
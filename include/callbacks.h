@@ -84,6 +84,9 @@ void tlib_on_interrupt_begin(uint64_t exception_index);
 void tlib_on_interrupt_end(uint64_t exception_index);
 void tlib_on_memory_access(uint32_t operation, uint64_t addr);
 void tlib_on_memory_access_event_enabled(int32_t value);
+void tlib_add_memory_access_hook_range(uint64_t start, uint64_t length);
+void tlib_clear_memory_access_hook_ranges(void);
+uint32_t tlib_on_pc_hook(uint64_t pc, uint32_t callback_id);
 
 uint32_t tlib_is_in_debug_mode(void);
 
@@ -538,6 +538,9 @@ extern CPUState *cpu;
 /* Debug event pending.  */
 #define CPU_INTERRUPT_DEBUG     0x0080
 
+/* The instructions count alarm (instructions_count_alarm) has expired.  */
+#define CPU_INTERRUPT_ALARM     0x2000
+
 /* Several target-specific external hardware interrupts.  Each target/cpu.h
    should define proper names based on these defines.  */
 #define CPU_INTERRUPT_TGT_EXT_0 0x0008
@@ -555,7 +558,7 @@ extern CPUState *cpu;
 #define CPU_INTERRUPT_TGT_INT_1 0x0400
 #define CPU_INTERRUPT_TGT_INT_2 0x0800
 
-/* First unused bit: 0x2000.  */
+/* First unused bit: 0x4000.  */
 
 typedef void (*CPUInterruptHandler)(CPUState *, int);
 
@@ -589,6 +592,7 @@ target_phys_addr_t cpu_get_phys_page_debug(CPUState *env, target_ulong addr);
 /* memory API */
 
 extern uintptr_t translation_cache_size;
+extern uint32_t translation_cache_huge_pages;
 
 typedef struct dirty_ram_t {
     uint8_t *phys_dirty;
@@ -615,6 +619,9 @@ extern dirty_ram_t dirty_ram;
 #define TLB_NOTDIRTY      (1 << 4)
 /* Set if TLB entry is an IO callback.  */
 #define TLB_MMIO          (1 << 5)
+/* Set if the page overlaps a memory access hook range, so that each
+   data access goes through the softmmu helpers and can be reported.  */
+#define TLB_WATCHED       (1 << 6)
 
 #define CODE_DIRTY_FLAG   0x02
 
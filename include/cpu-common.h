@@ -42,6 +42,13 @@ ram_addr_t cpu_get_physical_page_desc(target_phys_addr_t addr);
 void *get_ram_ptr(ram_addr_t addr);
 /* This should not be used by devices.  */
 ram_addr_t ram_addr_from_host(void *ptr);
+void host_memory_region_register(ram_addr_t guest_offset, ram_addr_t size, void *host_ptr);
+int host_memory_region_unregister(ram_addr_t guest_offset);
+void host_memory_regions_clear(void);
+void *ram_alloc(ram_addr_t size);
+void ram_free(void *ptr, ram_addr_t size);
+void *file_ram_map(const char *path, uint64_t offset, ram_addr_t size, int read_only);
+void file_ram_unmap(void *ptr, ram_addr_t size);
 
 void cpu_physical_memory_rw(target_phys_addr_t addr, uint8_t *buf, int len, int is_write);
 static inline void cpu_physical_memory_read(target_phys_addr_t addr, void *buf, int len)
@@ -82,6 +82,7 @@ typedef struct DisasContextBase {
     target_ulong npc;
     int mem_idx;
     int is_jmp;
+    int superblock_jump; /* the last instruction was a jump translated through */
 } DisasContextBase;
 
 #define HOST_LONG_SIZE     (HOST_LONG_BITS / 8)
@@ -145,7 +146,24 @@ typedef struct CPUBreakpoint {
     QTAILQ_ENTRY(CPUBreakpoint) entry;
 } CPUBreakpoint;
 
+/* inclusive range of addresses reported by tlib_on_memory_access */
+typedef struct MemoryAccessHookRange {
+    target_ulong start;
+    target_ulong end;
+} MemoryAccessHookRange;
+
+typedef struct PCHook {
+    target_ulong pc;
+    uint32_t callback_id;
+    /* changes made while a block is executing take effect once it exits, \
+       so that the block can still be retranslated to restore the state */
+    uint8_t added;
+    uint8_t removed;
+} PCHook;
+
 #define CPU_TEMP_BUF_NLONGS 128
+/* maximum number of hot blocks waiting to be retranslated with optimizations */
+#define TB_PROMOTION_QUEUE_SIZE 8
 #define CPU_COMMON                                                           \
     /* --------------------------------------- */                            \
     /* warning: cleared by CPU reset           */                            \
@@ -155,6 +173,9 @@ typedef struct CPUBreakpoint {
     uint64_t instructions_count_threshold;                                   \
     uint64_t instructions_count_value;                                       \
     uint64_t instructions_count_total_value;                                 \
+    /* when non-zero, CPU_INTERRUPT_ALARM is raised once \
+       instructions_count_total_value reaches it */                          \
+    uint64_t instructions_count_alarm;                                       \
     /* soft mmu support */                                                   \
     /* in order to avoid passing too many arguments to the MMIO \
        helpers, we store some rarely used information in the CPU \
@@ -183,6 +204,16 @@ typedef struct CPUBreakpoint {
     int chaining_disabled;                                                   \
     /* tb cache is enabled by default */                                     \
     int tb_cache_disabled;                                                   \
+    /* superblocks are enabled by default */                                 \
+    int superblocks_disabled;                                                \
+    /* when set, missed blocks are translated outside of the execution loop */ \
+    int deferred_translation_enabled;                                        \
+    /* number of executions after which a first tier block is optimized, \
+       0 disables tiered translation */                                      \
+    uint32_t tb_tier2_threshold;                                             \
+    /* pcs of the hot blocks to retranslate with optimizations, oldest first */ \
+    target_ulong tb_promotion_pcs[TB_PROMOTION_QUEUE_SIZE];                  \
+    int tb_promotion_count;                                                  \
     /* indicates if the block_finished hook is registered, implicitly \
                           disabling block chaining */                        \
     int block_finished_hook_present;                                         \
@@ -204,6 +235,18 @@ typedef struct CPUBreakpoint {
     long temp_buf[CPU_TEMP_BUF_NLONGS];                                      \
     /* when set any exception will force `cpu_exec` to finish immediately */ \
     int32_t return_on_exception;                                             \
+    /* sorted, disjoint ranges limiting the accesses reported by \
+       tlib_on_memory_access; all accesses are reported if there are none */ \
+    MemoryAccessHookRange *memory_access_hook_ranges;                        \
+    int32_t memory_access_hook_ranges_count;                                 \
+    /* callbacks called before executing the instruction at a given pc, \
+       sorted by pc */                                                       \
+    PCHook *pc_hooks;                                                        \
+    int32_t pc_hooks_count;                                                  \
+    /* set when some hooks are marked as added or removed */                 \
+    int32_t pc_hooks_pending;                                                \
+    /* shadow stack and events of the call tracer, NULL when disabled */     \
+    struct CallTrace *call_trace;                                            \
                                                                              \
 
 #endif
@@ -48,7 +48,10 @@ void gen_exit_tb_no_chaining(TranslationBlock *);
 CPUBreakpoint *process_breakpoints(CPUState *env, target_ulong pc);
 int gen_intermediate_code(CPUState *env, DisasContextBase *base);
 int gen_breakpoint(DisasContextBase *base, CPUBreakpoint *bp);
+void gen_sync_guest_pc(DisasContextBase *base);
 uint32_t gen_intermediate_code_epilogue(CPUState *env, DisasContextBase *base);
+int tb_superblocks_allowed(CPUState *env);
+int tb_superblock_continue(DisasContextBase *base, target_ulong next_pc, target_ulong target);
 void do_interrupt(CPUState *env);
 void setup_disas_context(DisasContextBase *dc, CPUState *env);
 void restore_state_to_opc(CPUState *env, struct TranslationBlock *tb, int pc_pos);
@@ -56,10 +59,11 @@ void restore_state_to_opc(CPUState *env, struct TranslationBlock *tb, int pc_pos
 void cpu_gen_code(CPUState *env, struct TranslationBlock *tb, int *gen_code_size_ptr);
 int cpu_restore_state(CPUState *env, struct TranslationBlock *tb, uintptr_t searched_pc);
 int cpu_restore_state_and_restore_instructions_count(CPUState *env, struct TranslationBlock *tb, uintptr_t searched_pc);
-TranslationBlock *tb_gen_code(CPUState *env, target_ulong pc, target_ulong cs_base, int flags, uint16_t cflags);
+TranslationBlock *tb_gen_code(CPUState *env, target_ulong pc, target_ulong cs_base, uint64_t flags, uint32_t cflags);
 void cpu_exec_init(CPUState *env);
 void cpu_exec_init_all();
 void TLIB_NORETURN cpu_loop_exit(CPUState *env1);
+void TLIB_NORETURN cpu_loop_exit_without_hook(CPUState *env);
 void TLIB_NORETURN cpu_loop_exit_restore(CPUState *env1, uintptr_t pc, uint32_t call_hook);
 void tb_invalidate_phys_page_range(tb_page_addr_t start, tb_page_addr_t end, int is_cpu_write_access);
 void tlb_flush_page(CPUState *env, target_ulong addr);
@@ -80,6 +84,9 @@ void tlb_set_page(CPUState *env, target_ulong vaddr, target_phys_addr_t paddr, i
 
 extern uint32_t maximum_block_size;
 
+/* maximum number of instructions in a first tier (CF_TIER1) block */
+#define TB_TIER1_MAX_INSNS 32
+
 struct TranslationBlock {
     target_ulong pc;      /* simulated PC corresponding to this block (EIP + CS base) */
     target_ulong cs_base; /* CS base for this block */
@@ -87,8 +94,12 @@ struct TranslationBlock {
     uint32_t disas_flags;
     uint16_t size;        /* size of target code for this block (1 <=
                              size <= TARGET_PAGE_SIZE) */
-    uint16_t cflags;      /* compile flags */
-#define CF_COUNT_MASK 0x7fff
+    uint32_t cflags;      /* compile flags */
+#define CF_COUNT_MASK  0x1fff
+#define CF_TIER1       0x2000 /* cheap translation, retranslated with optimizations once hot */
+#define CF_DEFERRED    0x4000 /* translated outside of the execution path, must not fault on code fetch */
+#define CF_PROVISIONAL 0x8000 /* unoptimized placeholder used until the deferred translation is ready */
+#define CF_SUPERBLOCKS 0x10000 /* translated through unconditional direct jumps, see tb_superblock_continue */
 
     uint8_t *tc_ptr;      /* pointer to the translated code */
     /* next matching tb for physical address. */
@@ -118,6 +129,11 @@ struct TranslationBlock {
     // signals that the `icount` of this tb has been added to global instructions counters
     // in case of exiting this tb before the end (e.g., in case of an exception, watchpoint etc.) the value of counters must be rebuilt
     uint32_t instructions_count_dirty;
+    // number of executions of a CF_TIER1 block, used to trigger its optimized retranslation
+    uint32_t exec_count;
+    // incremented whenever the TB is invalidated or its slot is reused, so that a saved
+    // pointer can be checked to still refer to the same live block
+    uint32_t generation;
 #if DEBUG
     uint32_t lock_active;
     char *lock_file;
@@ -125,6 +141,109 @@ struct TranslationBlock {
 #endif
 };
 
+/* TB flags above the 32 bits reported by cpu_get_tb_cpu_state are set by the
+   common code for state that is not architecture specific */
+#define TB_FLAG_MEMORY_HOOKS (1ULL << 32) /* calls softmmu helpers that report memory accesses */
+
+static inline void cpu_get_tb_cpu_state(CPUState *env, target_ulong *pc, target_ulong *cs_base, int *flags);
+
+/* the complete lookup key of the translation block to execute next */
+static inline void tb_get_cpu_state(CPUState *env, target_ulong *pc, target_ulong *cs_base, uint64_t *flags)
+{
+    int cpu_flags;
+
+    cpu_get_tb_cpu_state(env, pc, cs_base, &cpu_flags);
+    *flags = (uint32_t)cpu_flags;
+    if (env->tlib_is_on_memory_access_enabled) {
+        *flags |= TB_FLAG_MEMORY_HOOKS;
+    }
+}
+
+/* returns non-zero if any address in [first, last] is in a memory access hook range */
+static inline int memory_access_hook_ranges_overlap(CPUState *env, target_ulong first, target_ulong last)
+{
+    int low = 0;
+    int high = env->memory_access_hook_ranges_count;
+
+    /* find the first range that does not end before 'first' */
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (env->memory_access_hook_ranges[mid].end < first) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < env->memory_access_hook_ranges_count && env->memory_access_hook_ranges[low].start <= last;
+}
+
+static inline int memory_access_is_watched(CPUState *env, target_ulong addr, int size)
+{
+    return env->memory_access_hook_ranges_count == 0 || memory_access_hook_ranges_overlap(env, addr, addr + size - 1);
+}
+
+void memory_access_hook_range_add(CPUState *env, target_ulong start, target_ulong end);
+void memory_access_hook_ranges_clear(CPUState *env);
+
+/* returns the index of the first hook registered at 'pc' or of the first hook after it */
+static inline int pc_hooks_lower_bound(CPUState *env, target_ulong pc)
+{
+    int low = 0;
+    int high = env->pc_hooks_count;
+
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (env->pc_hooks[mid].pc < pc) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/* tells if the blocks containing 'pc' are translated with the hook call, the hooks
+   added while executing a block are not taken into account until it exits */
+static inline int pc_has_hooks(CPUState *env, target_ulong pc)
+{
+    int i;
+    for (i = pc_hooks_lower_bound(env, pc); i < env->pc_hooks_count && env->pc_hooks[i].pc == pc; i++) {
+        if (!env->pc_hooks[i].added) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Queue the block at 'pc' for the optimized retranslation, the oldest entry is dropped when full.  */
+static inline void tb_promotion_push(CPUState *env, target_ulong pc)
+{
+    if (env->tb_promotion_count == TB_PROMOTION_QUEUE_SIZE) {
+        memmove(&env->tb_promotion_pcs[0], &env->tb_promotion_pcs[1], (TB_PROMOTION_QUEUE_SIZE - 1) * sizeof(target_ulong));
+        env->tb_promotion_count--;
+    }
+    env->tb_promotion_pcs[env->tb_promotion_count++] = pc;
+}
+
+/* Returns nonzero and removes 'pc' from the queue if its block was promoted.  */
+static inline int tb_promotion_take(CPUState *env, target_ulong pc)
+{
+    int i;
+    for (i = 0; i < env->tb_promotion_count; i++) {
+        if (env->tb_promotion_pcs[i] == pc) {
+            env->tb_promotion_count--;
+            memmove(&env->tb_promotion_pcs[i], &env->tb_promotion_pcs[i + 1], (env->tb_promotion_count - i) * sizeof(target_ulong));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void cpu_pc_hook_insert(CPUState *env, target_ulong pc, uint32_t callback_id);
+int cpu_pc_hook_remove(CPUState *env, target_ulong pc, uint32_t callback_id);
+void cpu_pc_hooks_apply_pending(CPUState *env);
+void cpu_pc_hooks_remove_all(CPUState *env);
+
 static inline unsigned int tb_jmp_cache_hash_page(target_ulong pc)
 {
     target_ulong tmp;
@@ -185,6 +304,21 @@ static inline void tb_set_jmp_target1(uintptr_t jmp_addr, uintptr_t addr)
 #error tb_set_jmp_target1 is missing
 #endif
 
+#if defined(__x86_64__)
+/* The code buffer is not confined to the low 2GB, so a TB placed more than
+   2GB away cannot be reached with a patched 32-bit direct jump.  */
+static inline int tb_jmp_target_in_range(TranslationBlock *tb, int n, uintptr_t addr)
+{
+    intptr_t disp = addr - ((uintptr_t)tb->tc_ptr + tb->tb_jmp_offset[n] + 4);
+    return disp == (int32_t)disp;
+}
+#else
+static inline int tb_jmp_target_in_range(TranslationBlock *tb, int n, uintptr_t addr)
+{
+    return 1;
+}
+#endif
+
 static inline void tb_set_jmp_target(TranslationBlock *tb, int n, uintptr_t addr)
 {
     uintptr_t offset;
@@ -196,7 +330,7 @@ static inline void tb_set_jmp_target(TranslationBlock *tb, int n, uintptr_t addr
 static inline void tb_add_jump(TranslationBlock *tb, int n, TranslationBlock *tb_next)
 {
     /* NOTE: this test is only needed for thread safety */
-    if (!tb->jmp_next[n]) {
+    if (!tb->jmp_next[n] && tb_jmp_target_in_range(tb, n, (uintptr_t)tb_next->tc_ptr)) {
         /* patch the native jump address */
         tb_set_jmp_target(tb, n, (uintptr_t)tb_next->tc_ptr);
 
@@ -260,6 +394,25 @@ static inline tb_page_addr_t get_page_addr_code(CPUState *env1, target_ulong add
     return ram_addr_from_host(p);
 }
 
+/* upper bound of the number of bytes a single guest instruction can span */
+#define TARGET_MAX_INSN_SIZE 16
+
+/* Returns nonzero if the instruction at 'addr' can be fetched using the
+   current code TLB entries only, i.e. without any risk of a guest fault. */
+static inline int tb_code_fetch_is_cached(CPUState *env1, target_ulong addr)
+{
+    int mmu_idx;
+    target_ulong last;
+
+    mmu_idx = cpu_mmu_index(env1);
+    last = addr + TARGET_MAX_INSN_SIZE - 1;
+    return env1->tlb_table[mmu_idx][(addr >> TARGET_PAGE_BITS) & (CPU_TLB_SIZE - 1)].addr_code == (addr & TARGET_PAGE_MASK) &&
+           env1->tlb_table[mmu_idx][(last >> TARGET_PAGE_BITS) & (CPU_TLB_SIZE - 1)].addr_code == (last & TARGET_PAGE_MASK);
+}
+
+TranslationBlock *tb_gen_provisional_code(CPUState *env, target_ulong pc, target_ulong cs_base, uint64_t flags);
+void tb_process_deferred_translations(CPUState *env);
+
 typedef void (CPUDebugExcpHandler)(CPUState *env);
 
 CPUDebugExcpHandler *cpu_set_debug_excp_handler(CPUDebugExcpHandler *handler);
@@ -4,6 +4,9 @@ DEF_HELPER_1(prepare_block_for_execution, void, ptr)
 DEF_HELPER_1(update_instructions_count, void, i32)
 DEF_HELPER_2(block_begin_event, i32, tl, i32)
 DEF_HELPER_2(block_finished_event, void, tl, i32)
+DEF_HELPER_1(pc_hook_event, void, tl)
+DEF_HELPER_2(call_trace_call, void, tl, tl)
+DEF_HELPER_1(call_trace_return, void, tl)
 DEF_HELPER_2(log, void, i32, i32)
 DEF_HELPER_1(var_log, void, tl)
 DEF_HELPER_0(abort, void)
@@ -165,3 +165,23 @@
 
 #define SHIFT     3
 #include "softmmu_template.h"
+
+#undef MMUSUFFIX
+#define MMUSUFFIX _mmu_nohook
+#define SOFTMMU_NO_MEMORY_HOOKS
+
+#define SHIFT     0
+#include "softmmu_template.h"
+
+#define SHIFT     1
+#include "softmmu_template.h"
+
+#define SHIFT     2
+#include "softmmu_template.h"
+
+#define SHIFT     3
+#include "softmmu_template.h"
+
+#undef SOFTMMU_NO_MEMORY_HOOKS
+#undef MMUSUFFIX
+#define MMUSUFFIX _mmu
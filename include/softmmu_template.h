@@ -57,6 +57,15 @@ extern void *global_retaddr;
 #define ADDR_READ        addr_read
 #endif
 
+/* The _nohook variants are selected at translation time when memory access
+   hooks are disabled, so they can skip testing for them on every access. */
+#ifdef SOFTMMU_NO_MEMORY_HOOKS
+#define MEMORY_ACCESS_REPORTED(addr) 0
+#else
+#define MEMORY_ACCESS_REPORTED(addr) \
+    unlikely(cpu->tlib_is_on_memory_access_enabled != 0 && memory_access_is_watched(cpu, addr, DATA_SIZE))
+#endif
+
 #define MEMORY_IO_READ 0
 #define MEMORY_IO_WRITE 1
 #define MEMORY_READ 2
@@ -75,7 +84,7 @@ void notdirty_mem_writel(void *opaque, target_phys_addr_t ram_addr, uint32_t val
 #define SWAP_BYTES(n) (((n & 0xFF) << 24) | ((n & 0xFF00) << 8) | ((n & 0xFF0000) >> 8) | ((n & 0xFF000000) >> 24))
 
 static DATA_TYPE glue(glue(slow_ld, SUFFIX), MMUSUFFIX)(target_ulong addr, int mmu_idx, void *retaddr);
-static inline DATA_TYPE glue(io_read, SUFFIX)(target_phys_addr_t physaddr, target_ulong addr, void *retaddr)
+static inline DATA_TYPE glue(glue(io_read, SUFFIX), MMUSUFFIX)(target_phys_addr_t physaddr, target_ulong addr, void *retaddr)
 {
     DATA_TYPE res;
     physaddr = (physaddr & TARGET_PAGE_MASK) + addr;
@@ -132,7 +141,7 @@ DATA_TYPE REGPARM glue(glue(__ld, SUFFIX), MMUSUFFIX)(target_ulong addr, int mmu
     }
 
 redo:
-    tlb_addr = cpu->tlb_table[mmu_idx][index].ADDR_READ & ~TLB_ONE_SHOT;
+    tlb_addr = cpu->tlb_table[mmu_idx][index].ADDR_READ & ~(TLB_ONE_SHOT | TLB_WATCHED);
 
     if ((addr & TARGET_PAGE_MASK) == (tlb_addr & (TARGET_PAGE_MASK | TLB_INVALID_MASK))) {
         if (tlb_addr & ~TARGET_PAGE_MASK) {
@@ -143,8 +152,8 @@ redo:
             retaddr = GETPC();
             global_retaddr = retaddr;
             ioaddr = cpu->iotlb[mmu_idx][index];
-            res = glue(io_read, SUFFIX)(ioaddr, addr, retaddr);
-            if(unlikely(cpu->tlib_is_on_memory_access_enabled != 0))
+            res = glue(glue(io_read, SUFFIX), MMUSUFFIX)(ioaddr, addr, retaddr);
+            if(MEMORY_ACCESS_REPORTED(addr))
             {
                 tlib_on_memory_access(MEMORY_IO_READ, addr);
             }
@@ -158,7 +167,7 @@ do_unaligned_access:
             }
 #endif
             res = glue(glue(slow_ld, SUFFIX), MMUSUFFIX)(addr, mmu_idx, retaddr);
-            if(unlikely(cpu->tlib_is_on_memory_access_enabled != 0))
+            if(MEMORY_ACCESS_REPORTED(addr))
             {
                 tlib_on_memory_access(MEMORY_READ, addr);
             }
@@ -172,7 +181,7 @@ do_unaligned_access:
 #endif
             addend = cpu->tlb_table[mmu_idx][index].addend;
             res = glue(glue(ld, USUFFIX), _raw)((uint8_t *)(uintptr_t)(addr + addend));
-            if(unlikely(cpu->tlib_is_on_memory_access_enabled != 0))
+            if(MEMORY_ACCESS_REPORTED(addr))
             {
                 tlib_on_memory_access(MEMORY_READ, addr);
             }
@@ -217,7 +226,7 @@ static DATA_TYPE glue(glue(slow_ld, SUFFIX), MMUSUFFIX)(target_ulong addr, int m
     }
 
 redo:
-    tlb_addr = cpu->tlb_table[mmu_idx][index].ADDR_READ & ~TLB_ONE_SHOT;
+    tlb_addr = cpu->tlb_table[mmu_idx][index].ADDR_READ & ~(TLB_ONE_SHOT | TLB_WATCHED);
 
     if ((addr & TARGET_PAGE_MASK) == (tlb_addr & (TARGET_PAGE_MASK | TLB_INVALID_MASK))) {
         if (tlb_addr & ~TARGET_PAGE_MASK) {
@@ -226,7 +235,7 @@ redo:
                 goto do_unaligned_access;
             }
             ioaddr = cpu->iotlb[mmu_idx][index];
-            res = glue(io_read, SUFFIX)(ioaddr, addr, retaddr);
+            res = glue(glue(io_read, SUFFIX), MMUSUFFIX)(ioaddr, addr, retaddr);
         } else if (((addr & ~TARGET_PAGE_MASK) + DATA_SIZE - 1) >= TARGET_PAGE_SIZE) {
 do_unaligned_access:
             /* slow unaligned access (it spans two pages) */
@@ -258,7 +267,7 @@ do_unaligned_access:
 
 static void glue(glue(slow_st, SUFFIX), MMUSUFFIX)(target_ulong addr, DATA_TYPE val, int mmu_idx, void *retaddr);
 
-static inline void glue(io_write, SUFFIX)(target_phys_addr_t physaddr, DATA_TYPE val, target_ulong addr, void *retaddr)
+static inline void glue(glue(io_write, SUFFIX), MMUSUFFIX)(target_phys_addr_t physaddr, DATA_TYPE val, target_ulong addr, void *retaddr)
 {
 #if SHIFT <= 2
     int index;
@@ -321,7 +330,7 @@ void REGPARM glue(glue(__st, SUFFIX), MMUSUFFIX)(target_ulong addr, DATA_TYPE va
     }
 
 redo:
-    tlb_addr = cpu->tlb_table[mmu_idx][index].addr_write & ~TLB_ONE_SHOT;
+    tlb_addr = cpu->tlb_table[mmu_idx][index].addr_write & ~(TLB_ONE_SHOT | TLB_WATCHED);
 
     if ((addr & TARGET_PAGE_MASK) == (tlb_addr & (TARGET_PAGE_MASK | TLB_INVALID_MASK))) {
         if (tlb_addr & ~TARGET_PAGE_MASK) {
@@ -332,8 +341,8 @@ redo:
             retaddr = GETPC();
             global_retaddr = retaddr;
             ioaddr = cpu->iotlb[mmu_idx][index];
-            glue(io_write, SUFFIX)(ioaddr, val, addr, retaddr);
-            if(unlikely(cpu->tlib_is_on_memory_access_enabled != 0))
+            glue(glue(io_write, SUFFIX), MMUSUFFIX)(ioaddr, val, addr, retaddr);
+            if(MEMORY_ACCESS_REPORTED(addr))
             {
                 tlib_on_memory_access(MEMORY_IO_WRITE, addr);
             }
@@ -346,7 +355,7 @@ do_unaligned_access:
             }
 #endif
             glue(glue(slow_st, SUFFIX), MMUSUFFIX)(addr, val, mmu_idx, retaddr);
-            if(unlikely(cpu->tlib_is_on_memory_access_enabled != 0))
+            if(MEMORY_ACCESS_REPORTED(addr))
             {
                 tlib_on_memory_access(MEMORY_WRITE, addr);
             }
@@ -360,7 +369,7 @@ do_unaligned_access:
 #endif
             addend = cpu->tlb_table[mmu_idx][index].addend;
             glue(glue(st, SUFFIX), _raw)((uint8_t *)(uintptr_t)(addr + addend), val);
-            if(unlikely(cpu->tlib_is_on_memory_access_enabled != 0))
+            if(MEMORY_ACCESS_REPORTED(addr))
             {
                 tlib_on_memory_access(MEMORY_WRITE, addr);
             }
@@ -403,7 +412,7 @@ static void glue(glue(slow_st, SUFFIX), MMUSUFFIX)(target_ulong addr, DATA_TYPE
     }
 
 redo:
-    tlb_addr = cpu->tlb_table[mmu_idx][index].addr_write & ~TLB_ONE_SHOT;
+    tlb_addr = cpu->tlb_table[mmu_idx][index].addr_write & ~(TLB_ONE_SHOT | TLB_WATCHED);
 
     if ((addr & TARGET_PAGE_MASK) == (tlb_addr & (TARGET_PAGE_MASK | TLB_INVALID_MASK))) {
         if (tlb_addr & ~TARGET_PAGE_MASK) {
@@ -412,7 +421,7 @@ redo:
                 goto do_unaligned_access;
             }
             ioaddr = cpu->iotlb[mmu_idx][index];
-            glue(io_write, SUFFIX)(ioaddr, val, addr, retaddr);
+            glue(glue(io_write, SUFFIX), MMUSUFFIX)(ioaddr, val, addr, retaddr);
         } else if (((addr & ~TARGET_PAGE_MASK) + DATA_SIZE - 1) >= TARGET_PAGE_SIZE) {
 do_unaligned_access:
             /* XXX: not efficient, but simple */
@@ -440,6 +449,7 @@ do_unaligned_access:
 #endif /* !defined(SOFTMMU_CODE_ACCESS) */
 
 #undef READ_ACCESS_TYPE
+#undef MEMORY_ACCESS_REPORTED
 #undef SHIFT
 #undef DATA_TYPE
 #undef SUFFIX
@@ -12,6 +12,12 @@
 
 extern TCGv_ptr cpu_env;
 
+/* used by the translators on call and return instructions; nothing is
+   generated while the call tracing is disabled */
+void gen_call_trace_call(TCGv target, target_ulong return_address);
+void gen_call_trace_calli(target_ulong target, target_ulong return_address);
+void gen_call_trace_return(TCGv target);
+
 void gen_helpers(void)
 {
 #define GEN_HELPER 2
@@ -890,6 +890,9 @@ static void tcg_out_setcond2(TCGContext *s, const TCGArg *args, const int *const
 }
 #endif
 
+/* The code buffer may be placed anywhere in the 64-bit address space, so
+   destinations out of the rel32 range are reached through R10, which is
+   call-clobbered and never used to pass arguments.  */
 static void tcg_out_branch(TCGContext *s, int call, tcg_target_long dest)
 {
     tcg_target_long disp = dest - (tcg_target_long)s->code_ptr - 5;
@@ -966,18 +969,18 @@ static inline void tcg_out_tlb_load(TCGContext *s, int addrlo_idx, int mem_index
     tcg_out_mov(s, type, r0, addrlo);
 
     /* jne label1 */
-    tcg_out8(s, OPC_JCC_short + JCC_JNE);
+    tcg_out_opc(s, OPC_JCC_long + JCC_JNE, 0, 0, 0);
     label_ptr[0] = s->code_ptr;
-    s->code_ptr++;
+    s->code_ptr += 4;
 
     if (TARGET_LONG_BITS > TCG_TARGET_REG_BITS) {
         /* cmp 4(r1), addrhi */
         tcg_out_modrm_offset(s, OPC_CMP_GvEv, args[addrlo_idx + 1], r1, 4);
 
         /* jne label1 */
-        tcg_out8(s, OPC_JCC_short + JCC_JNE);
+        tcg_out_opc(s, OPC_JCC_long + JCC_JNE, 0, 0, 0);
         label_ptr[1] = s->code_ptr;
-        s->code_ptr++;
+        s->code_ptr += 4;
     }
 
     /* TLB Hit.  */
@@ -1063,6 +1066,27 @@ static void tcg_out_qemu_ld_direct(TCGContext *s, int datalo, int datahi, int ba
     }
 }
 
+/* Record the TLB miss path of a memory access; the jumps from the fast
+   path are patched once the path is emitted at the end of the block.  */
+static void add_ldst_slow_path(TCGContext *s, int is_ld, int opc, int datalo_reg, int datahi_reg, int addrhi_reg,
+                               int mem_index, uint8_t **label_ptr)
+{
+    TCGLdstSlowPath *l = &s->ldst_slow_paths[s->nb_ldst_slow_paths++];
+
+    l->is_ld = is_ld;
+    l->opc = opc;
+    l->datalo_reg = datalo_reg;
+    l->datahi_reg = datahi_reg;
+    l->addrhi_reg = addrhi_reg;
+    l->mem_index = mem_index;
+    l->op_index = s->op_index;
+    l->label_ptr[0] = label_ptr[0];
+    if (TARGET_LONG_BITS > TCG_TARGET_REG_BITS) {
+        l->label_ptr[1] = label_ptr[1];
+    }
+    l->raddr = s->code_ptr;
+}
+
 /* XXX: qemu_ld and qemu_st could be modified to clobber only EDX and
    EAX. It will be useful once fixed registers globals are less
    common. */
@@ -1070,8 +1094,9 @@ static void tcg_out_qemu_ld(TCGContext *s, const TCGArg *args, int opc)
 {
     int data_reg, data_reg2 = 0;
     int addrlo_idx;
-    int mem_index, s_bits, arg_idx;
-    uint8_t *label_ptr[3];
+    int addrhi_reg = 0;
+    int mem_index, s_bits;
+    uint8_t *label_ptr[2];
 
     data_reg = args[0];
     addrlo_idx = 1;
@@ -1080,6 +1105,9 @@ static void tcg_out_qemu_ld(TCGContext *s, const TCGArg *args, int opc)
         addrlo_idx = 2;
     }
 
+    if (TARGET_LONG_BITS > TCG_TARGET_REG_BITS) {
+        addrhi_reg = args[addrlo_idx + 1];
+    }
     mem_index = args[addrlo_idx + 1 + (TARGET_LONG_BITS > TCG_TARGET_REG_BITS)];
     s_bits = opc & 3;
 
@@ -1088,24 +1116,24 @@ static void tcg_out_qemu_ld(TCGContext *s, const TCGArg *args, int opc)
     /* TLB Hit.  */
     tcg_out_qemu_ld_direct(s, data_reg, data_reg2, tcg_target_call_iarg_regs[0], 0, opc);
 
-    /* jmp label2 */
-    tcg_out8(s, OPC_JMP_short);
-    label_ptr[2] = s->code_ptr;
-    s->code_ptr++;
-
-    /* TLB Miss.  */
+    /* TLB Miss, out of line.  */
+    add_ldst_slow_path(s, 1, opc, data_reg, data_reg2, addrhi_reg, mem_index, label_ptr);
+}
 
-    /* label1: */
-    *label_ptr[0] = s->code_ptr - label_ptr[0] - 1;
-    if (TARGET_LONG_BITS > TCG_TARGET_REG_BITS) {
-        *label_ptr[1] = s->code_ptr - label_ptr[1] - 1;
-    }
+static void tcg_out_qemu_ld_slow_path(TCGContext *s, TCGLdstSlowPath *l)
+{
+    int opc = l->opc;
+    int data_reg = l->datalo_reg;
+    int data_reg2 = l->datahi_reg;
+    int addrhi_reg = l->addrhi_reg;
+    int mem_index = l->mem_index;
+    int s_bits = opc & 3;
+    int arg_idx;
 
-    /* XXX: move that code at the end of the TB */
     /* The first argument is already loaded with addrlo.  */
     arg_idx = 1;
     if (TCG_TARGET_REG_BITS == 32 && TARGET_LONG_BITS == 64) {
-        tcg_out_mov(s, TCG_TYPE_I32, tcg_target_call_iarg_regs[arg_idx++], args[addrlo_idx + 1]);
+        tcg_out_mov(s, TCG_TYPE_I32, tcg_target_call_iarg_regs[arg_idx++], addrhi_reg);
     }
     tcg_out_movi(s, TCG_TYPE_I32, tcg_target_call_iarg_regs[arg_idx], mem_index);
 
@@ -1162,9 +1190,6 @@ static void tcg_out_qemu_ld(TCGContext *s, const TCGArg *args, int opc)
     default:
         tcg_abort();
     }
-
-    /* label2: */
-    *label_ptr[2] = s->code_ptr - label_ptr[2] - 1;
 }
 
 static void tcg_out_qemu_st_direct(TCGContext *s, int datalo, int datahi, int base, tcg_target_long ofs, int sizeop)
@@ -1229,9 +1254,9 @@ static void tcg_out_qemu_st(TCGContext *s, const TCGArg *args, int opc)
 {
     int data_reg, data_reg2 = 0;
     int addrlo_idx;
+    int addrhi_reg = 0;
     int mem_index, s_bits;
-    int stack_adjust;
-    uint8_t *label_ptr[3];
+    uint8_t *label_ptr[2];
 
     data_reg = args[0];
     addrlo_idx = 1;
@@ -1240,6 +1265,9 @@ static void tcg_out_qemu_st(TCGContext *s, const TCGArg *args, int opc)
         addrlo_idx = 2;
     }
 
+    if (TARGET_LONG_BITS > TCG_TARGET_REG_BITS) {
+        addrhi_reg = args[addrlo_idx + 1];
+    }
     mem_index = args[addrlo_idx + 1 + (TARGET_LONG_BITS > TCG_TARGET_REG_BITS)];
     s_bits = opc;
 
@@ -1249,20 +1277,20 @@ static void tcg_out_qemu_st(TCGContext *s, const TCGArg *args, int opc)
     /* TLB Hit.  */
     tcg_out_qemu_st_direct(s, data_reg, data_reg2, tcg_target_call_iarg_regs[0], 0, opc);
 
-    /* jmp label2 */
-    tcg_out8(s, OPC_JMP_short);
-    label_ptr[2] = s->code_ptr;
-    s->code_ptr++;
-
-    /* TLB Miss.  */
+    /* TLB Miss, out of line.  */
+    add_ldst_slow_path(s, 0, opc, data_reg, data_reg2, addrhi_reg, mem_index, label_ptr);
+}
 
-    /* label1: */
-    *label_ptr[0] = s->code_ptr - label_ptr[0] - 1;
-    if (TARGET_LONG_BITS > TCG_TARGET_REG_BITS) {
-        *label_ptr[1] = s->code_ptr - label_ptr[1] - 1;
-    }
+static void tcg_out_qemu_st_slow_path(TCGContext *s, TCGLdstSlowPath *l)
+{
+    int opc = l->opc;
+    int data_reg = l->datalo_reg;
+    int data_reg2 = l->datahi_reg;
+    int addrhi_reg = l->addrhi_reg;
+    int mem_index = l->mem_index;
+    int s_bits = opc;
+    int stack_adjust;
 
-    /* XXX: move that code at the end of the TB */
     if (TCG_TARGET_REG_BITS == 64) {
         tcg_out_mov(s, (opc == 3 ? TCG_TYPE_I64 : TCG_TYPE_I32), tcg_target_call_iarg_regs[1], data_reg);
         tcg_out_movi(s, TCG_TYPE_I32, tcg_target_call_iarg_regs[2], mem_index);
@@ -1279,13 +1307,13 @@ static void tcg_out_qemu_st(TCGContext *s, const TCGArg *args, int opc)
         }
     } else {
         if (opc == 3) {
-            tcg_out_mov(s, TCG_TYPE_I32, TCG_REG_EDX, args[addrlo_idx + 1]);
+            tcg_out_mov(s, TCG_TYPE_I32, TCG_REG_EDX, addrhi_reg);
             tcg_out_pushi(s, mem_index);
             tcg_out_push(s, data_reg2);
             tcg_out_push(s, data_reg);
             stack_adjust = 12;
         } else {
-            tcg_out_mov(s, TCG_TYPE_I32, TCG_REG_EDX, args[addrlo_idx + 1]);
+            tcg_out_mov(s, TCG_TYPE_I32, TCG_REG_EDX, addrhi_reg);
             switch (opc) {
             case 0:
                 tcg_out_ext8u(s, TCG_REG_ECX, data_reg);
@@ -1325,9 +1353,24 @@ static void tcg_out_qemu_st(TCGContext *s, const TCGArg *args, int opc)
     } else if (stack_adjust != 0) {
         tcg_out_addi(s, TCG_REG_CALL_STACK, stack_adjust);
     }
+}
 
-    /* label2: */
-    *label_ptr[2] = s->code_ptr - label_ptr[2] - 1;
+static void tcg_out_ldst_slow_path(TCGContext *s, TCGLdstSlowPath *l)
+{
+    /* label1: */
+    patch_reloc(l->label_ptr[0], R_386_PC32, (tcg_target_long)s->code_ptr, -4);
+    if (TARGET_LONG_BITS > TCG_TARGET_REG_BITS) {
+        patch_reloc(l->label_ptr[1], R_386_PC32, (tcg_target_long)s->code_ptr, -4);
+    }
+
+    if (l->is_ld) {
+        tcg_out_qemu_ld_slow_path(s, l);
+    } else {
+        tcg_out_qemu_st_slow_path(s, l);
+    }
+
+    /* jmp label2 */
+    tcg_out_jmp(s, (tcg_target_long)l->raddr);
 }
 
 /* *INDENT-OFF* */
@@ -130,6 +130,9 @@ typedef enum {
 
 #define TCG_TARGET_HAS_GUEST_BASE
 
+/* TLB miss paths are emitted out of line, at the end of the block */
+#define TCG_TARGET_LDST_SLOW_PATHS
+
 /* Note: must be synced with cpu-defs.h */
 #if TCG_TARGET_REG_BITS == 64
 # define TCG_AREG0 TCG_REG_R14
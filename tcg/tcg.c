@@ -1180,8 +1180,11 @@ do_not_remove:
     }
 }
 #else
-/* dummy liveness analysis */
-static void tcg_liveness_analysis(TCGContext *s)
+#define tcg_liveness_analysis tcg_dummy_liveness_analysis
+#endif
+
+/* dummy liveness analysis: all arguments are considered live */
+static void tcg_dummy_liveness_analysis(TCGContext *s)
 {
     int nb_ops;
     nb_ops = gen_opc_ptr - tcg->gen_opc_buf;
@@ -1189,7 +1192,6 @@ static void tcg_liveness_analysis(TCGContext *s)
     s->op_dead_args = tcg_malloc(nb_ops * sizeof(uint16_t));
     memset(s->op_dead_args, 0, nb_ops * sizeof(uint16_t));
 }
-#endif
 
 static void temp_allocate_frame(TCGContext *s, int temp)
 {
@@ -1762,16 +1764,24 @@ static inline int tcg_gen_code_common(TCGContext *s, uint8_t *gen_code_buf, uint
     unsigned int dead_args;
     const TCGArg *args;
 
+    if (s->optimizations_disabled) {
+        /* cheap first tier translation */
+        tcg_dummy_liveness_analysis(s);
+    } else {
 #ifdef USE_TCG_OPTIMIZATIONS
-    gen_opparam_ptr =
-        tcg_optimize(s, gen_opc_ptr, tcg->gen_opparam_buf, tcg_op_defs);
+        gen_opparam_ptr =
+            tcg_optimize(s, gen_opc_ptr, tcg->gen_opparam_buf, tcg_op_defs);
 #endif
 
-    tcg_liveness_analysis(s);
+        tcg_liveness_analysis(s);
+    }
 
     tcg_reg_alloc_start(s);
     s->code_buf = gen_code_buf;
     s->code_ptr = gen_code_buf;
+#ifdef TCG_TARGET_LDST_SLOW_PATHS
+    s->nb_ldst_slow_paths = 0;
+#endif
 
     args = tcg->gen_opparam_buf;
     op_index = 0;
@@ -1833,6 +1843,9 @@ static inline int tcg_gen_code_common(TCGContext *s, uint8_t *gen_code_buf, uint
                faster to have specialized register allocator functions for
                some common argument patterns */
             dead_args = s->op_dead_args[op_index];
+#ifdef TCG_TARGET_LDST_SLOW_PATHS
+            s->op_index = op_index;
+#endif
             tcg_reg_alloc_op(s, def, opc, args, dead_args);
             break;
         }
@@ -1844,6 +1857,16 @@ next:
         op_index++;
     }
 the_end:
+#ifdef TCG_TARGET_LDST_SLOW_PATHS
+    /* the cold TLB miss paths follow the hot code of the block; a host pc
+       inside one of them belongs to the memory access that branched there */
+    for (op_index = 0; op_index < s->nb_ldst_slow_paths; op_index++) {
+        tcg_out_ldst_slow_path(s, &s->ldst_slow_paths[op_index]);
+        if (search_pc < s->code_ptr - gen_code_buf) {
+            return s->ldst_slow_paths[op_index].op_index;
+        }
+    }
+#endif
     return -1;
 }
 
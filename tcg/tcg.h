@@ -339,6 +339,22 @@ typedef struct TCGHelperInfo {
     const char *name;
 } TCGHelperInfo;
 
+#ifdef TCG_TARGET_LDST_SLOW_PATHS
+/* TLB miss path of a guest memory access, emitted after the hot code of
+   the block so that the fast paths of consecutive accesses stay dense */
+typedef struct TCGLdstSlowPath {
+    int is_ld;
+    int opc;
+    int datalo_reg;
+    int datahi_reg;
+    int addrhi_reg;
+    int mem_index;
+    int op_index;           /* operation the access belongs to, for search_pc */
+    uint8_t *label_ptr[2];  /* displacements of the jumps from the fast path */
+    uint8_t *raddr;         /* where the fast path resumes */
+} TCGLdstSlowPath;
+#endif
+
 typedef struct TCGContext TCGContext;
 
 struct TCGContext {
@@ -361,6 +377,8 @@ struct TCGContext {
     /* liveness analysis */
     uint16_t *op_dead_args; /* for each operation, each bit tells if the
                                corresponding argument is dead */
+    /* skip the optimizer and the liveness analysis */
+    int optimizations_disabled;
 
     /* tells in which temporary a given register is. It does not take
        into account fixed registers */
@@ -374,6 +392,13 @@ struct TCGContext {
     uint8_t *code_ptr;
     TCGTemp static_temps[TCG_MAX_TEMPS];
 
+#ifdef TCG_TARGET_LDST_SLOW_PATHS
+    /* a block holds at most one memory access per operation */
+    TCGLdstSlowPath ldst_slow_paths[OPC_BUF_SIZE];
+    int nb_ldst_slow_paths;
+    int op_index;
+#endif
+
     TCGHelperInfo *helpers;
     int nb_helpers;
     int allocated_helpers;